@@ -0,0 +1,483 @@
+// host microbenchmarks
+
+
+
+// INCLUDES
+
+#include "cpu.hpp"
+#include "decoder.hpp"
+#include "defines.h"
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ios>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>  // getopt, mkstemp, unlink, write
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::cpu;
+using namespace cpu_emu::isa;
+using namespace cpu_emu::memory;
+
+
+
+// STRUCT DEFINITIONS
+
+struct stats_t
+{
+    double min;  // nanoseconds per operation
+    double median;
+    double mean;
+    double stddev;
+};  // END struct stats_t
+
+
+
+// CONSTEXPR DEFINITIONS
+
+constexpr std::size_t op_count = std::size_t( 1 ) << 20;  // per repetition
+
+}  // END namespace
+
+
+
+// STATIC FUNCTION DEFINITIONS
+
+// Times `rep_count` calls of `fn`, each doing `op_count` operations, after
+// one call to warm up the caches and predictors.
+template< typename T_fn >
+static
+stats_t
+measure(
+    std::size_t rep_count,
+    T_fn fn
+)
+{
+    fn();
+
+    std::vector< double > ns_vec;
+    for ( std::size_t rep_ = 0;  rep_ < rep_count;  ++rep_ ) {
+        const auto start_time = std::chrono::steady_clock::now();
+        fn();
+        const std::chrono::duration< double, std::nano > elapsed =
+                std::chrono::steady_clock::now() - start_time;
+        ns_vec.push_back( elapsed.count() / op_count );
+    }
+    std::sort( ns_vec.begin(), ns_vec.end() );
+
+    const double mean =
+            std::accumulate( ns_vec.begin(), ns_vec.end(), 0.0 ) / rep_count;
+    double square_sum = 0;
+    for ( const auto ns : ns_vec ) { square_sum += (ns - mean) * (ns - mean); }
+
+    return {
+        ns_vec.front(),
+        ns_vec[ rep_count / 2 ],
+        mean,
+        std::sqrt( square_sum / rep_count )
+    };
+}
+
+static
+void
+report(
+    const std::string &group,
+    const std::string &case_,
+    const stats_t &stats
+)
+{
+    std::cout << "bench_host: group: " << group
+              << ", case: " << case_
+              << ", ns_per_op_min: " << stats.min
+              << ", ns_per_op_median: " << stats.median
+              << ", ns_per_op_mean: " << stats.mean
+              << ", ns_per_op_stddev: " << stats.stddev << std::endl;
+}
+
+// Returns the non-zero words of the memory; a zero word is never code.
+static
+std::vector< iword_t >
+code_iwords(
+    const Memory &mem
+)
+{
+    std::vector< iword_t > iword_vec;
+    for (
+        addr_t addr = 0;
+        addr + sizeof( iword_t ) <= mem.get_mem_size();
+        addr += sizeof( iword_t )
+    ) {
+        if ( const auto iword = mem.lw( addr ) ) {
+            iword_vec.push_back( iword );
+        }
+    }
+    if ( iword_vec.empty() ) {
+        throw std::runtime_error( "The image holds no code." );
+    }
+
+    return iword_vec;
+}
+
+static
+bool
+same(
+    const cinstr_t &lhs,
+    const cinstr_t &rhs
+)
+{
+    return lhs.imm  == rhs.imm
+        && lhs.mnem == rhs.mnem
+        && lhs.rd   == rhs.rd
+        && lhs.rs1  == rhs.rs1
+        && lhs.rs2  == rhs.rs2;
+}
+
+static
+void
+bench_decode(
+    const Memory &mem,
+    std::size_t rep_count
+)
+{
+    const auto real_vec = code_iwords( mem );
+    std::vector< iword_t > random_vec( real_vec.size() );
+    iword_t state = 0x12345678;
+    for ( auto &iword : random_vec ) {
+        state ^= state << 13;  state ^= state >> 17;  state ^= state << 5;
+        iword = state;
+    }
+
+    for ( const auto &[ name, iword_vec ] : {
+        std::pair< const char *, const std::vector< iword_t > & >{
+            "real", real_vec },
+        { "random", random_vec }
+    } ) {
+        // the decoders must agree before their speeds are worth comparing
+        for ( const auto iword : iword_vec ) {
+            if ( !same( decoder::compact( decoder::decode( iword ) ),
+                        decoder::decode_compact( iword ) ) ) {
+                std::cout << "bench_host: group: decode, mismatch: "
+                          << std::hex << std::showbase << iword << std::endl;
+
+                throw std::runtime_error( "The decoders disagree." );
+            }
+        }
+
+        // cycle through the words until `op_count` are decoded
+        const auto run = [ & ]( auto decode )
+        {
+            volatile word_t sink;
+            word_t sum = 0;
+            for ( std::size_t i_ = 0, j_ = 0;  i_ < op_count;  ++i_ ) {
+                const auto cinstr = decode( iword_vec[ j_ ] );
+                sum += cinstr.imm + static_cast< word_t >( cinstr.mnem );
+                if ( ++j_ == iword_vec.size() ) { j_ = 0; }
+            }
+            sink = sum;
+            (void) sink;
+        };
+
+        report( "decode", std::string( name ) + "_switch", measure(
+            rep_count,
+            [ & ] {
+                run( []( iword_t iword ) {
+                    return decoder::compact( decoder::decode( iword ) );
+                } );
+            }
+        ) );
+        report( "decode", std::string( name ) + "_table", measure(
+            rep_count,
+            [ & ] { run( decoder::decode_compact ); }
+        ) );
+    }
+}
+
+static
+void
+bench_memory(
+    Memory &mem,
+    std::size_t rep_count
+)
+{
+    // sequential addresses within a window that fits in the image
+    constexpr addr_t window_size = 0x10000;  // 64 KiB
+    if ( mem.get_mem_size() < window_size + sizeof( std::uint64_t ) ) {
+        throw std::runtime_error( "The image is too small." );
+    }
+
+    for ( const addr_t width : { 1, 2, 4, 8 } ) {
+        for ( const addr_t offset : { 0, 1 } ) {
+            if ( offset && width == 1 ) { continue; }  // always aligned
+
+            std::vector< addr_t > addr_vec( op_count );
+            for ( std::size_t i_ = 0;  i_ < op_count;  ++i_ ) {
+                addr_vec[ i_ ] = (i_ * width & (window_size - 1)) + offset;
+            }
+
+            const std::string case_ = std::to_string( width * 8 )
+                                    + (offset ? "_misaligned" : "_aligned");
+            const auto load = [ & ]( auto load_fn )
+            {
+                volatile std::uint64_t sink;
+                std::uint64_t sum = 0;
+                for ( const auto addr : addr_vec ) { sum += load_fn( addr ); }
+                sink = sum;
+                (void) sink;
+            };
+            const auto store = [ & ]( auto store_fn )
+            {
+                for ( const auto addr : addr_vec ) { store_fn( addr ); }
+            };
+
+            stats_t load_stats;
+            stats_t store_stats;
+            switch ( width ) {
+                case 1:
+                    load_stats = measure( rep_count, [ & ] {
+                        load( [ & ]( addr_t a ) { return mem.lb( a ); } ); } );
+                    store_stats = measure( rep_count, [ & ] {
+                        store( [ & ]( addr_t a ) { mem.sb( a, a ); } ); } );
+
+                    break;
+                case 2:
+                    load_stats = measure( rep_count, [ & ] {
+                        load( [ & ]( addr_t a ) { return mem.lh( a ); } ); } );
+                    store_stats = measure( rep_count, [ & ] {
+                        store( [ & ]( addr_t a ) { mem.sh( a, a ); } ); } );
+
+                    break;
+                case 4:
+                    load_stats = measure( rep_count, [ & ] {
+                        load( [ & ]( addr_t a ) { return mem.lw( a ); } ); } );
+                    store_stats = measure( rep_count, [ & ] {
+                        store( [ & ]( addr_t a ) { mem.sw( a, a ); } ); } );
+
+                    break;
+                default:
+                    load_stats = measure( rep_count, [ & ] {
+                        load( [ & ]( addr_t a ) { return mem.ld( a ); } ); } );
+                    store_stats = measure( rep_count, [ & ] {
+                        store( [ & ]( addr_t a ) { mem.sd( a, a ); } ); } );
+
+                    break;
+            }
+            report( "memory", "load" + case_, load_stats );
+            report( "memory", "store" + case_, store_stats );
+        }
+    }
+}
+
+// Encodes an instruction with the fixed bits of `mnem`; the operands are
+// placed as the format of its opcode requires.
+static
+iword_t
+encode(
+    mnem_e mnem,
+    iword_t rd,
+    iword_t rs1,
+    iword_t rs2,
+    word_t imm
+)
+{
+    const auto it = std::find_if(
+        std::begin( encoding_arr ), std::end( encoding_arr ),
+        [ mnem ]( const encoding_t &encoding )
+        {
+            return encoding.mnem == mnem;
+        }
+    );
+    iword_t iword = it->match | rd << 7 | rs1 << 15 | rs2 << 20;
+
+    switch ( opcode_type( opcode_e{ it->match & 0x7f } ) ) {
+        case opcode_type_e::imm:
+            return iword | imm << 20;
+        case opcode_type_e::store:
+            return (iword & ~(0x1fu << 7))
+                 | (imm & 0x1f) << 7 | (imm >> 5 & 0x7f) << 25;
+        case opcode_type_e::branch:
+            return (iword & ~(0x1fu << 7))
+                 | (imm >> 11 & 1) << 7 | (imm >> 1 & 0xf) << 8
+                 | (imm >> 5 & 0x3f) << 25 | (imm >> 12 & 1) << 31;
+        case opcode_type_e::upper:
+            return iword | (imm & 0xfffff000);
+        case opcode_type_e::jump:
+            return iword
+                 | (imm >> 12 & 0xff) << 12 | (imm >> 11 & 1) << 20
+                 | (imm >> 1 & 0x3ff) << 21 | (imm >> 20 & 1) << 31;
+
+        default:  return iword;
+    }
+}
+
+// Writes a memory image with `code_vec` at address 0, followed by a jump
+// back to it; returns the file path.
+static
+std::string
+write_code_image(
+    const std::vector< iword_t > &code_vec,
+    std::size_t mem_size
+)
+{
+    char path_carr[] = "/tmp/bench_host.XXXXXX";
+    const int fd = mkstemp( path_carr );
+    if ( fd == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    std::vector< iword_t > image_vec( mem_size / sizeof( iword_t ) );
+    std::copy( code_vec.begin(), code_vec.end(), image_vec.begin() );
+    image_vec[ code_vec.size() ] = encode(
+        mnem_e::JAL, 0, 0, 0, -word_t( code_vec.size() * sizeof( iword_t ) ) );
+
+    const auto size = image_vec.size() * sizeof( iword_t );
+    const bool ok = write( fd, image_vec.data(), size ) == ssize_t( size );
+    close( fd );
+    if ( !ok ) {
+        unlink( path_carr );
+        throw std::runtime_error( "Could not write the code image." );
+    }
+
+    return path_carr;
+}
+
+// Runs straight-line code of one opcode class on the interpreter; the decode
+// cache is warm, so this is mostly the dispatch and execution of each step.
+static
+void
+bench_dispatch(
+    std::size_t rep_count
+)
+{
+    constexpr std::size_t block_length = 64;
+    constexpr std::size_t mem_size     = STACK_START_ADDR;
+    using reg_idx_ns::zero;
+    using reg_idx_ns::sp;
+    using reg_idx_ns::t0;
+    using reg_idx_ns::t1;
+    using reg_idx_ns::t2;
+
+    for ( const auto &[ name, iword ] : {
+        std::pair< const char *, iword_t >{
+            "arith_r", encode( mnem_e::ADD,  t0, t1, t2, 0 ) },
+        { "arith_i",   encode( mnem_e::ADDI, t0, t1, 0, 1 ) },
+        { "load",      encode( mnem_e::LW,   t0, sp, 0, -64 ) },
+        { "store",     encode( mnem_e::SW,   0, sp, t0, -64 ) },
+        { "branch",    encode( mnem_e::BNE,  0, zero, zero, 8 ) },  // not taken
+        { "upper",     encode( mnem_e::LUI,  t0, 0, 0, 0x12345000 ) },
+        { "jump",      encode( mnem_e::JAL,  zero, 0, 0, 4 ) },
+    } ) {
+        const auto path = write_code_image(
+            std::vector< iword_t >( block_length, iword ), mem_size );
+        try {
+            Cpu cpu( 0, mem_size, path, map_e::copy_on_write );
+            unlink( path.c_str() );
+
+            report( "dispatch", name, measure(
+                rep_count,
+                [ & ] { cpu.run( op_count ); }
+            ) );
+        }
+        catch ( ... ) {
+            unlink( path.c_str() );
+            throw;
+        }
+    }
+}
+
+
+
+// MAIN FUNCTION
+
+int
+main(
+    int argc,
+    char *argv[]
+)
+{
+    const std::string usage = std::string( "Usage: " ) + argv[ 0 ]
+            + " [-r <rep_count>] [-g <group>]... [<mem_img_path>]\n"
+            + "  <group>: decode, memory, dispatch; all by default\n"
+            + "  -r: timed repetitions per case, after one to warm up;"
+            + " 10 by default\n"
+            + "  <mem_img_path>: code for decode, memory for memory;"
+            + " " MEM_IMG_PATH ".clean by default";
+
+    std::size_t rep_count = 10;
+    std::vector< std::string > group_vec;
+
+    for ( int opt; (opt = getopt( argc, argv, "r:g:" )) != -1; ) {
+        switch ( opt ) {
+            case 'r':
+                rep_count = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 'g':
+                group_vec.push_back( optarg );
+
+                break;
+
+            default:
+                std::cout << usage << std::endl;
+
+                return EXIT_FAILURE;
+        }
+    }
+    const auto is_group = [ & ]( const std::string &group )
+    {
+        return std::find( group_vec.begin(), group_vec.end(), group )
+            != group_vec.end();
+    };
+    if (
+        argc - optind > 1 || !rep_count
+     || std::any_of(
+            group_vec.begin(), group_vec.end(),
+            []( const std::string &group )
+            {
+                return group != "decode" && group != "memory"
+                    && group != "dispatch";
+            }
+        )
+    ) {
+        std::cout << usage << std::endl;
+
+        return EXIT_FAILURE;
+    }
+    if ( group_vec.empty() ) { group_vec = { "decode", "memory", "dispatch" }; }
+
+    const std::string mem_img_path = optind < argc
+                                   ? argv[ optind ]
+                                   : MEM_IMG_PATH ".clean";
+
+    std::cout << "bench_host: rep_count: " << rep_count
+              << ", op_count: " << op_count << std::endl;
+    if ( is_group( "decode" ) || is_group( "memory" ) ) {
+        Memory mem( mem_img_path, map_e::copy_on_write );
+
+        if ( is_group( "decode" ) ) { bench_decode( mem, rep_count ); }
+        if ( is_group( "memory" ) ) { bench_memory( mem, rep_count ); }
+    }
+    if ( is_group( "dispatch" ) ) { bench_dispatch( rep_count ); }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,247 @@
+// guest benchmark driver
+
+
+
+// INCLUDES
+
+#include "cpu.hpp"
+#include "defines.h"
+#include "memory.hpp"
+#include "runner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>  // getopt
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::cpu;
+using namespace cpu_emu::memory;
+
+
+
+// STRUCT DEFINITIONS
+
+struct measurement_t
+{
+    instance_result_t instance;  // of the first repetition
+    double            elapsed_s;  // median over the repetitions
+    bool              stable;     // all repetitions behaved the same
+};  // END struct measurement_t
+
+}  // END namespace
+
+
+
+// STATIC FUNCTION DEFINITIONS
+
+// Returns the file name without directories and extension; e.g., "sort".
+static
+std::string
+program_name(
+    const std::string &path
+)
+{
+    const auto begin = path.find_last_of( '/' ) + 1;  // npos + 1 == 0
+    const auto end   = path.find_last_of( '.' );
+
+    return path.substr(
+        begin, end != std::string::npos && end > begin ? end - begin
+                                                       : std::string::npos );
+}
+
+static
+bool
+same_behavior(
+    const instance_result_t &lhs,
+    const instance_result_t &rhs
+)
+{
+    return lhs.run_result.step_count  == rhs.run_result.step_count
+        && lhs.run_result.stop        == rhs.run_result.stop
+        && lhs.run_result.exit_status == rhs.run_result.exit_status
+        && lhs.run_result.trap.cause  == rhs.run_result.trap.cause
+        && lhs.run_result.trap.pc     == rhs.run_result.trap.pc
+        && lhs.out_str == rhs.out_str
+        && lhs.err_str == rhs.err_str
+        && lhs.fault   == rhs.fault;
+}
+
+// Runs the program `rep_count` times, each from a fresh copy-on-write view
+// of the image; the first run also warms up the host caches.
+static
+measurement_t
+measure(
+    const Image &image,
+    const runner_config_t &runner_config,
+    const std::string &input,
+    std::size_t rep_count
+)
+{
+    const Runner runner( image, runner_config );
+
+    measurement_t measurement{ {}, 0, true };
+    std::vector< double > elapsed_vec;
+    for ( std::size_t rep_ = 0;  rep_ < rep_count;  ++rep_ ) {
+        auto instance = runner.run( { input } ).instance_vec.front();
+
+        elapsed_vec.push_back( instance.elapsed_s );
+        if ( !rep_ ) {
+            measurement.instance = std::move( instance );
+        }
+        else if ( !same_behavior( instance, measurement.instance ) ) {
+            measurement.stable = false;
+        }
+    }
+
+    std::sort( elapsed_vec.begin(), elapsed_vec.end() );
+    measurement.elapsed_s = elapsed_vec[ elapsed_vec.size() / 2 ];
+
+    return measurement;
+}
+
+
+
+// MAIN FUNCTION
+
+int
+main(
+    int argc,
+    char *argv[]
+)
+{
+    const std::string usage = std::string( "Usage: " ) + argv[ 0 ]
+            + " [-e <engine>]... [-r <rep_count>] [-n <step_count>]"
+            + " <program_path>...\n"
+            + "  <engine>: interp, threaded, jit; all by default\n"
+            + "  -r: runs per program and engine; the median time counts;"
+            + " 3 by default\n"
+            + "  -n: stop each run after <step_count> steps\n"
+            + "  <program_path>: memory image or RV32 ELF executable;"
+            + " each run reads all of the standard input";
+
+    std::vector< engine_e > engine_vec;
+    std::size_t rep_count = 3;
+    std::size_t max_steps = -1;
+
+    for ( int opt; (opt = getopt( argc, argv, "e:r:n:" )) != -1; ) {
+        engine_e engine;
+
+        switch ( opt ) {
+            case 'e':
+                if ( !parse_engine( optarg, engine ) ) {
+                    std::cout << usage << std::endl;
+
+                    return EXIT_FAILURE;
+                }
+                engine_vec.push_back( engine );
+
+                break;
+            case 'r':
+                rep_count = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 'n':
+                max_steps = std::stoull( optarg, nullptr, 0 );
+
+                break;
+
+            default:
+                std::cout << usage << std::endl;
+
+                return EXIT_FAILURE;
+        }
+    }
+    if ( optind == argc || !rep_count ) {
+        std::cout << usage << std::endl;
+
+        return EXIT_FAILURE;
+    }
+    if ( engine_vec.empty() ) {
+        engine_vec = { engine_e::interp, engine_e::threaded, engine_e::jit };
+    }
+
+    // every run reads the same input
+    const std::string input(
+        (std::istreambuf_iterator< char >( std::cin )),
+        std::istreambuf_iterator< char >()
+    );
+
+    // one line per program and engine, then one per engine; `key: value`
+    // pairs, as printed by `main`
+    bool failed = false;
+    std::vector< double > log_mips_sum_vec( engine_vec.size(), 0 );
+    for ( int arg_ = optind;  arg_ < argc;  ++arg_ ) {
+        const std::string path = argv[ arg_ ];
+        const Image image( path );
+
+        runner_config_t runner_config;
+        runner_config.thread_count = 1;
+        runner_config.max_steps    = max_steps;
+        if ( const auto &elf = image.get_elf() ) {
+            runner_config.pc_reg = elf->get_entry();
+        }
+
+        const instance_result_t *reference = nullptr;
+        std::vector< measurement_t > measurement_vec;
+        measurement_vec.reserve( engine_vec.size() );
+        for ( std::size_t i_ = 0;  i_ < engine_vec.size();  ++i_ ) {
+            runner_config.engine = engine_vec[ i_ ];
+            const auto &measurement = measurement_vec.emplace_back(
+                    measure( image, runner_config, input, rep_count ) );
+            const auto &instance   = measurement.instance;
+            const auto &run_result = instance.run_result;
+            const double mips =
+                    run_result.step_count / measurement.elapsed_s / 1e6;
+
+            // the engines must agree before their speeds are worth comparing
+            if ( !reference ) { reference = &instance; }
+            const bool ok = instance.fault.empty()
+                         && run_result.stop != stop_e::trap
+                         && measurement.stable
+                         && same_behavior( instance, *reference )
+                         && (run_result.stop != stop_e::exit
+                          || !run_result.exit_status);
+
+            std::cout << "bench: program: " << program_name( path )
+                      << ", engine: " << engine_str( engine_vec[ i_ ] )
+                      << ", stop: " << (instance.fault.empty()
+                                        ? stop_str( run_result.stop )
+                                        : "fault")
+                      << ", exit_status: " << run_result.exit_status
+                      << ", step_count: " << run_result.step_count
+                      << ", elapsed_s: " << measurement.elapsed_s
+                      << ", mips: " << mips
+                      << ", ok: " << (ok ? "yes" : "no");
+            if ( !instance.fault.empty() ) {
+                std::cout << ", fault: " << instance.fault;
+            }
+            std::cout << std::endl;
+
+            log_mips_sum_vec[ i_ ] += std::log( mips );
+            failed = failed || !ok;
+        }
+    }
+
+    const std::size_t program_count = argc - optind;
+    for ( std::size_t i_ = 0;  i_ < engine_vec.size();  ++i_ ) {
+        std::cout << "bench: engine: " << engine_str( engine_vec[ i_ ] )
+                  << ", program_count: " << program_count
+                  << ", geomean_mips: "
+                  << std::exp( log_mips_sum_vec[ i_ ] / program_count )
+                  << std::endl;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
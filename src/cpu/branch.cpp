@@ -0,0 +1,526 @@
+// branch prediction model
+
+
+
+// INCLUDES
+
+#include "branch.hpp"
+
+#include "isa.hpp"
+#include "memory.hpp"
+#include "report.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::branch;
+using namespace cpu_emu::isa;
+
+
+
+// CONSTEXPR DEFINITIONS
+
+constexpr addr_t iword_size = iword_length >> 3;
+
+
+
+// FUNCTION DEFINITIONS
+
+constexpr
+std::uint64_t
+low_mask(
+    unsigned length
+)
+{
+    return length < 64 ? (std::uint64_t( 1 ) << length) - 1
+                       : ~std::uint64_t( 0 );
+}
+
+// Folds the `length` most recent history bits into `bits` bits.
+std::uint64_t
+fold(
+    std::uint64_t history,
+    unsigned length,
+    unsigned bits
+)
+{
+    std::uint64_t result = 0;
+    for ( history &= low_mask( length );  history;  history >>= bits ) {
+        result ^= history & low_mask( bits );
+    }
+
+    return result;
+}
+
+// a 2-bit saturating counter; taken from 2 up
+void
+train(
+    std::uint8_t &counter,
+    bool taken
+)
+{
+    if      (  taken && counter < 3 ) { ++counter; }
+    else if ( !taken && counter > 0 ) { --counter; }
+}
+
+bool
+is_link(
+    reg_idx_t reg
+)
+{
+    return reg == reg_idx_ns::ra || reg == reg_idx_ns::t0;
+}
+
+
+
+// CLASS DEFINITIONS
+
+class Static_predictor final : public Predictor
+{
+public:
+    bool predict( addr_t pc, addr_t target ) override
+    {
+        return target <= pc;  // loops branch backward
+    }
+
+    void update( addr_t, addr_t, bool ) override
+    {}
+};  // END class Static_predictor
+
+class Bimodal_predictor final : public Predictor
+{
+private:
+    static constexpr unsigned index_bits = 12;
+
+    std::vector< std::uint8_t > counter_vec =
+            std::vector< std::uint8_t >( std::size_t( 1 ) << index_bits, 2 );
+
+    std::uint8_t &counter( addr_t pc )
+    {
+        return this->counter_vec[ (pc / iword_size) & low_mask( index_bits ) ];
+    }
+
+public:
+    bool predict( addr_t pc, addr_t ) override
+    {
+        return this->counter( pc ) >= 2;
+    }
+
+    void update( addr_t pc, addr_t, bool taken ) override
+    {
+        train( this->counter( pc ), taken );
+    }
+};  // END class Bimodal_predictor
+
+class Gshare_predictor final : public Predictor
+{
+private:
+    static constexpr unsigned index_bits   = 14;
+    static constexpr unsigned history_bits = 12;
+
+    std::vector< std::uint8_t > counter_vec =
+            std::vector< std::uint8_t >( std::size_t( 1 ) << index_bits, 2 );
+    std::uint64_t history = 0;
+
+    std::uint8_t &counter( addr_t pc )
+    {
+        return this->counter_vec[
+                ((pc / iword_size) ^ (this->history & low_mask( history_bits )))
+              & low_mask( index_bits ) ];
+    }
+
+public:
+    bool predict( addr_t pc, addr_t ) override
+    {
+        return this->counter( pc ) >= 2;
+    }
+
+    void update( addr_t pc, addr_t, bool taken ) override
+    {
+        train( this->counter( pc ), taken );
+        this->history = this->history << 1 | taken;
+    }
+};  // END class Gshare_predictor
+
+// A reduced TAGE: a bimodal base and tagged tables indexed by the pc and
+// geometrically longer global histories; the longest matching table
+// predicts. On a misprediction, an entry is allocated in a longer table.
+class Tage_predictor final : public Predictor
+{
+private:
+    static constexpr std::size_t table_count = 4;
+    static constexpr unsigned base_bits  = 12;
+    static constexpr unsigned index_bits = 10;
+    static constexpr unsigned tag_bits   = 9;
+    static constexpr std::array< unsigned, table_count > length_arr =
+            { 4, 9, 20, 44 };
+    static constexpr std::uint64_t reset_period = 0x40000;  // of `useful`
+
+    struct entry_t
+    {
+        std::uint16_t tag;
+        std::int8_t   counter;  // 3-bit signed; taken from 0 up
+        std::uint8_t  useful;   // 2-bit
+    };
+
+    std::vector< std::uint8_t > base_vec =
+            std::vector< std::uint8_t >( std::size_t( 1 ) << base_bits, 2 );
+    std::array< std::vector< entry_t >, table_count > table_arr;
+    std::uint64_t history = 0;
+    std::uint64_t update_count = 0;
+    // of the last `predict`
+    std::array< std::size_t, table_count >   index_arr{};
+    std::array< std::uint16_t, table_count > tag_arr{};
+    int  provider = -1;  // table; -1 for the base
+    bool provider_taken = false;
+    bool alt_taken      = false;  // of the next shorter match, or the base
+
+    std::uint8_t &base( addr_t pc )
+    {
+        return this->base_vec[ (pc / iword_size) & low_mask( base_bits ) ];
+    }
+
+public:
+    Tage_predictor()
+    {
+        for ( auto &table : this->table_arr ) {
+            table.assign( std::size_t( 1 ) << index_bits, entry_t{ 0, 0, 0 } );
+        }
+    }
+
+    bool predict( addr_t pc, addr_t ) override
+    {
+        const std::uint64_t pc_ = pc / iword_size;
+
+        this->provider  = -1;
+        this->alt_taken = this->base( pc ) >= 2;
+        this->provider_taken = this->alt_taken;
+        for ( std::size_t t_ = 0;  t_ < table_count;  ++t_ ) {
+            const unsigned length = length_arr[ t_ ];
+
+            this->index_arr[ t_ ] =
+                    (pc_ ^ pc_ >> index_bits
+                   ^ fold( this->history, length, index_bits ))
+                  & low_mask( index_bits );
+            this->tag_arr[ t_ ] =
+                    (pc_ ^ fold( this->history, length, tag_bits )
+                   ^ fold( this->history, length, tag_bits - 1 ) << 1)
+                  & low_mask( tag_bits );
+
+            const auto &entry = this->table_arr[ t_ ][ this->index_arr[ t_ ] ];
+            if ( entry.tag == this->tag_arr[ t_ ] ) {
+                this->alt_taken      = this->provider_taken;
+                this->provider       = int( t_ );
+                this->provider_taken = entry.counter >= 0;
+            }
+        }
+
+        return this->provider_taken;
+    }
+
+    void update( addr_t pc, addr_t, bool taken ) override
+    {
+        const bool miss = this->provider_taken != taken;
+
+        if ( this->provider < 0 ) {
+            train( this->base( pc ), taken );
+        }
+        else {
+            auto &entry = this->table_arr[ this->provider ][
+                    this->index_arr[ this->provider ] ];
+
+            if      (  taken && entry.counter <  3 ) { ++entry.counter; }
+            else if ( !taken && entry.counter > -4 ) { --entry.counter; }
+            if ( this->provider_taken != this->alt_taken ) {
+                if      ( !miss && entry.useful < 3 ) { ++entry.useful; }
+                else if (  miss && entry.useful > 0 ) { --entry.useful; }
+            }
+        }
+
+        // allocate in the first longer table with a useless entry; else,
+        // age the longer tables so that one frees up
+        if ( miss ) {
+            bool allocated = false;
+            for (
+                std::size_t t_ = this->provider + 1;
+                t_ < table_count;
+                ++t_
+            ) {
+                auto &entry = this->table_arr[ t_ ][ this->index_arr[ t_ ] ];
+                if ( !allocated && !entry.useful ) {
+                    entry = { this->tag_arr[ t_ ],
+                              std::int8_t( taken ? 0 : -1 ), 0 };
+                    allocated = true;
+                }
+            }
+            for (
+                std::size_t t_ = this->provider + 1;
+                !allocated && t_ < table_count;
+                ++t_
+            ) {
+                auto &entry = this->table_arr[ t_ ][ this->index_arr[ t_ ] ];
+                if ( entry.useful ) { --entry.useful; }
+            }
+        }
+
+        if ( ++this->update_count % reset_period == 0 ) {
+            for ( auto &table : this->table_arr ) {
+                for ( auto &entry : table ) { entry.useful >>= 1; }
+            }
+        }
+        this->history = this->history << 1 | taken;
+    }
+};  // END class Tage_predictor
+
+}  // END namespace
+
+
+
+namespace cpu_emu::branch {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Predictor::~Predictor()
+{}
+
+Model::Model(
+    predictor_e predictor_kind,
+    addr_t mem_size
+):
+    predictor_kind( predictor_kind ),
+    predictor( make_predictor( predictor_kind ) ),
+    pc_count_vec( (std::size_t( mem_size ) + iword_size - 1) / iword_size,
+                  count_t{ 0, 0 } )
+{}
+
+Model::~Model()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+bool
+Model::observe(
+    addr_t pc,
+    const isa::cinstr_t &instr,
+    addr_t next_pc
+)
+{
+    const auto mnem = instr.mnem;
+
+    if ( mnem >= mnem_e::BEQ && mnem <= mnem_e::BGEU ) {
+        const addr_t target = pc + instr.imm;
+        const bool   taken  = next_pc != pc + iword_size;
+        const bool   miss   = this->predictor->predict( pc, target ) != taken;
+
+        this->predictor->update( pc, target, taken );
+        this->count( this->branch_count, pc, miss );
+
+        return miss;
+    }
+    if ( mnem == mnem_e::JAL ) {
+        if ( is_link( instr.rd ) ) { this->push( pc + iword_size ); }
+        ++this->jump_count;
+
+        return false;
+    }
+    if ( mnem == mnem_e::JALR ) {
+        const bool rd_link  = is_link( instr.rd );
+        const bool rs1_link = is_link( instr.rs1 );
+
+        // a return, unless a call through the same link register
+        bool miss;
+        if ( rs1_link && !(rd_link && instr.rd == instr.rs1) ) {
+            addr_t addr;
+            miss = !this->pop( addr ) || addr != next_pc;
+            this->count( this->return_count, pc, miss );
+        }
+        else {
+            auto &target = this->target_arr[ (pc / iword_size) % target_size ];
+            miss   = target != next_pc;
+            target = next_pc;
+            this->count( this->indirect_count, pc, miss );
+        }
+        if ( rd_link ) { this->push( pc + iword_size ); }
+
+        return miss;
+    }
+
+    return false;
+}
+
+void
+Model::report(
+    std::ostream &os,
+    const memory::Memory &mem,
+    std::size_t top_count
+) const
+{
+    const auto flags     = os.flags();
+    const auto precision = os.precision();
+    os << std::fixed << std::setprecision( 2 );
+
+    const auto rate = []( const count_t &count_ )
+    {
+        return count_.count ? 100.0 * count_.miss_count / count_.count : 0.0;
+    };
+    const auto line = [ &os, &rate ]( const char *name, const count_t &count_ )
+    {
+        os << "branch: " << name << ": " << count_.count
+           << ", mispredicts: " << count_.miss_count
+           << ", miss_rate: " << rate( count_ ) << "%" << std::endl;
+    };
+
+    os << "branch: predictor: " << predictor_str( this->predictor_kind )
+       << ", direct_jumps: " << this->jump_count << std::endl;
+    line( "branches", this->branch_count );
+    line( "returns", this->return_count );
+    line( "indirect_jumps", this->indirect_count );
+
+    // most mispredictions first; ties by address, for a stable report
+    std::vector< addr_t > pc_vec;
+    for ( std::size_t i_ = 0;  i_ < this->pc_count_vec.size();  ++i_ ) {
+        if ( this->pc_count_vec[ i_ ].miss_count ) {
+            pc_vec.push_back( i_ * iword_size );
+        }
+    }
+    report::keep_top( pc_vec, top_count, [ this ]( addr_t pc )
+            {
+                return this->pc_count_vec[ pc / iword_size ].miss_count;
+            } );
+
+    for ( const auto pc : pc_vec ) {
+        const auto &count_ = this->pc_count_vec[ pc / iword_size ];
+
+        os << "branch: pc: " << std::hex << std::showbase << pc
+           << std::dec << std::noshowbase
+           << ", count: " << count_.count
+           << ", mispredicts: " << count_.miss_count
+           << ", miss_rate: " << rate( count_ ) << "%";
+        report::print_pc( os, mem, pc );
+        os << std::endl;
+    }
+
+    os.flags( flags );
+    os.precision( precision );
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+void
+Model::push(
+    addr_t addr
+)
+{
+    this->ras_arr[ this->ras_top ] = addr;
+    this->ras_top   = (this->ras_top + 1) % ras_size;
+    this->ras_depth = std::min( this->ras_depth + 1, ras_size );
+}
+
+bool
+Model::pop(
+    addr_t &addr
+)
+{
+    if ( !this->ras_depth ) { return false; }
+
+    this->ras_top = (this->ras_top + ras_size - 1) % ras_size;
+    --this->ras_depth;
+    addr = this->ras_arr[ this->ras_top ];
+
+    return true;
+}
+
+void
+Model::count(
+    count_t &total,
+    addr_t pc,
+    bool miss
+)
+{
+    ++total.count;
+    total.miss_count += miss;
+
+    const std::size_t index = pc / iword_size;
+    if ( index < this->pc_count_vec.size() ) {
+        ++this->pc_count_vec[ index ].count;
+        this->pc_count_vec[ index ].miss_count += miss;
+    }
+}
+
+
+
+// FUNCTION DEFINITIONS
+
+const char *
+predictor_str(
+    predictor_e predictor
+)
+{
+    switch ( predictor ) {
+        case predictor_e::static_:  return "static";
+        case predictor_e::bimodal:  return "bimodal";
+        case predictor_e::gshare:   return "gshare";
+        case predictor_e::tage:     return "tage";
+    }
+
+    return "";
+}
+
+bool
+parse_predictor(
+    const std::string &str,
+    predictor_e &predictor
+)
+{
+    for (
+        auto predictor_ : { predictor_e::static_, predictor_e::bimodal,
+                            predictor_e::gshare, predictor_e::tage }
+    ) {
+        if ( str == predictor_str( predictor_ ) ) {
+            predictor = predictor_;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::unique_ptr< Predictor >
+make_predictor(
+    predictor_e predictor
+)
+{
+    switch ( predictor ) {
+        case predictor_e::static_:
+            return std::make_unique< Static_predictor >();
+        case predictor_e::bimodal:
+            return std::make_unique< Bimodal_predictor >();
+        case predictor_e::gshare:
+            return std::make_unique< Gshare_predictor >();
+        case predictor_e::tage:
+            return std::make_unique< Tage_predictor >();
+    }
+
+    return nullptr;
+}
+
+}  // END namespace cpu_emu::branch
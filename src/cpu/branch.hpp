@@ -0,0 +1,124 @@
+#pragma once
+
+// branch prediction model
+
+
+
+// INCLUDES
+
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+
+namespace cpu_emu::branch {
+
+// ENUM CLASS DEFINITIONS
+
+enum class predictor_e
+{
+    static_,  // backward taken, forward not taken
+    bimodal,  // 2-bit counters by pc
+    gshare,   // 2-bit counters by pc and global history
+    tage,     // a bimodal base and tagged tables of geometric histories
+};  // END enum class predictor_e
+
+
+
+// CLASS DEFINITIONS
+
+// Predicts the direction of conditional branches.
+class Predictor
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    using addr_t = isa::addr_t;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    virtual ~Predictor();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    virtual bool predict( addr_t pc, addr_t target ) = 0;
+    // called after `predict` for the same branch, with its outcome
+    virtual void update( addr_t pc, addr_t target, bool taken ) = 0;
+};  // END class Predictor
+
+// Observes every control transfer: conditional branches go to a
+// `Predictor`, returns to a return-address stack, and other indirect jumps
+// to a last-target table; direct jumps are always predicted. Link
+// registers (`ra`, `t0`) follow the hints of the RISC-V specification.
+// Counts are kept overall and per pc.
+class Model final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    using addr_t = isa::addr_t;
+    static constexpr std::size_t ras_size    = 16;   // wraps when full
+    static constexpr std::size_t target_size = 256;  // indirect targets
+
+    struct count_t
+    {
+        std::uint64_t count;
+        std::uint64_t miss_count;  // mispredictions
+    };  // END struct count_t
+
+
+// DATA MEMBERS
+private:
+    predictor_e predictor_kind;
+    std::unique_ptr< Predictor > predictor;
+    std::array< addr_t, ras_size >    ras_arr{};
+    std::size_t                       ras_top   = 0;  // index of the next push
+    std::size_t                       ras_depth = 0;  // valid entries
+    std::array< addr_t, target_size > target_arr{};
+    count_t branch_count   = { 0, 0 };
+    count_t return_count   = { 0, 0 };
+    count_t indirect_count = { 0, 0 };
+    std::uint64_t jump_count = 0;  // direct; `jal`
+    std::vector< count_t > pc_count_vec;  // by pc / 4; within the memory
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Model( predictor_e predictor_kind, addr_t mem_size );
+    ~Model();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    // Returns whether the transfer, if any, was mispredicted; `next_pc`
+    // follows the instruction at `pc`.
+    bool observe( addr_t pc, const isa::cinstr_t &instr, addr_t next_pc );
+    // overall rates, then the `top_count` pcs with the most mispredictions
+    void report( std::ostream &os, const memory::Memory &mem,
+                 std::size_t top_count ) const;
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    void push( addr_t addr );
+    bool pop( addr_t &addr );  // false if empty
+    void count( count_t &total, addr_t pc, bool miss );
+};  // END class Model
+
+
+
+// FUNCTION DECLARATIONS
+
+const char *predictor_str( predictor_e predictor );
+bool parse_predictor( const std::string &str, predictor_e &predictor );
+std::unique_ptr< Predictor > make_predictor( predictor_e predictor );
+
+}  // END namespace cpu_emu::branch
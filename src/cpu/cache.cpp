@@ -0,0 +1,397 @@
+// cache model
+
+
+
+// INCLUDES
+
+#include "cache.hpp"
+
+#include "isa.hpp"
+#include "memory.hpp"
+#include "report.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::cache;
+using namespace cpu_emu::isa;
+
+
+
+// CONSTEXPR DEFINITIONS
+
+constexpr addr_t iword_size = iword_length >> 3;
+
+
+
+// FUNCTION DEFINITIONS
+
+bool
+is_power_of_two(
+    std::size_t value
+)
+{
+    return value && !(value & (value - 1));
+}
+
+std::size_t
+parse_size(
+    const std::string &str
+)
+{
+    std::size_t pos = 0;
+    std::size_t size = std::stoull( str, &pos, 0 );
+    const auto suffix = str.substr( pos );
+
+    if      ( suffix == "k" || suffix == "K" ) { size <<= 10; }
+    else if ( suffix == "m" || suffix == "M" ) { size <<= 20; }
+    else if ( !suffix.empty() ) {
+        throw std::invalid_argument( "Malformed size: '" + str + "'." );
+    }
+
+    return size;
+}
+
+double
+rate(
+    std::uint64_t count,
+    std::uint64_t total
+)
+{
+    return total ? 100.0 * count / total : 0.0;
+}
+
+}  // END namespace
+
+
+
+namespace cpu_emu::cache {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Cache::Cache(
+    const cache_config_t &config
+):
+    config( config )
+{
+    // lines of at least a word keep line numbers off `invalid_tag`, and
+    // keep any access within two lines
+    if (
+        !is_power_of_two( config.size ) || !is_power_of_two( config.line_size )
+     || config.line_size < 4 || !config.assoc
+     || config.size < config.line_size * config.assoc
+     || !is_power_of_two( config.size / config.line_size / config.assoc )
+    ) {
+        throw std::invalid_argument( "Malformed cache configuration." );
+    }
+
+    this->line_length = 0;
+    while ( std::size_t( 1 ) << this->line_length < config.line_size ) {
+        ++this->line_length;
+    }
+    this->set_mask = config.size / config.line_size / config.assoc - 1;
+    this->tag_vec.assign( config.size / config.line_size, invalid_tag );
+}
+
+Cache::~Cache()
+{}
+
+Hierarchy::Hierarchy(
+    const hierarchy_config_t &config,
+    addr_t mem_size
+):
+    l1i( config.l1i ),
+    l1d( config.l1d ),
+    l2( config.l2 ),
+    pc_stat_vec( (std::size_t( mem_size ) + iword_size - 1) / iword_size,
+                 pc_stat_t{ 0, 0, 0, 0 } )
+{}
+
+Hierarchy::~Hierarchy()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+bool
+Cache::access(
+    addr_t addr
+)
+{
+    const std::uint32_t line = addr >> this->line_length;
+    const std::size_t   assoc = this->config.assoc;
+    std::uint32_t *const set_carr =
+            this->tag_vec.data() + (line & this->set_mask) * assoc;
+
+    ++this->access_count;
+
+    std::size_t way = 0;
+    while ( way < assoc && set_carr[ way ] != line ) { ++way; }
+    if ( way < assoc ) {
+        if ( this->config.policy == policy_e::lru ) {
+            std::copy_backward( set_carr, set_carr + way, set_carr + way + 1 );
+            set_carr[ 0 ] = line;
+        }
+
+        return true;
+    }
+
+    ++this->miss_count;
+    if ( this->config.policy == policy_e::random ) {
+        auto &state = this->random_state;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        // an invalid way first, as the others would fill it
+        way = std::find( set_carr, set_carr + assoc, invalid_tag ) - set_carr;
+        set_carr[ way < assoc ? way : state % assoc ] = line;
+    }
+    else {
+        // the victim is last; the new line is first in either order
+        std::copy_backward( set_carr, set_carr + assoc - 1, set_carr + assoc );
+        set_carr[ 0 ] = line;
+    }
+
+    return false;
+}
+
+const cache_config_t &
+Cache::get_config() const
+{
+    return this->config;
+}
+
+std::uint64_t
+Cache::get_access_count() const
+{
+    return this->access_count;
+}
+
+std::uint64_t
+Cache::get_miss_count() const
+{
+    return this->miss_count;
+}
+
+level_e
+Hierarchy::fetch(
+    addr_t pc
+)
+{
+    if ( this->l1i.access( pc ) ) { return level_e::l1; }
+
+    const bool l2_hit = this->l2.access( pc );
+    if ( auto *stat = this->pc_stat( pc ) ) {
+        ++stat->l1i_miss_count;
+        stat->l2_miss_count += !l2_hit;
+    }
+
+    return l2_hit ? level_e::l2 : level_e::mem;
+}
+
+level_e
+Hierarchy::load(
+    addr_t pc,
+    addr_t addr,
+    addr_t size
+)
+{
+    return this->access_data( pc, addr, size );
+}
+
+level_e
+Hierarchy::store(
+    addr_t pc,
+    addr_t addr,
+    addr_t size
+)
+{
+    return this->access_data( pc, addr, size );
+}
+
+void
+Hierarchy::report(
+    std::ostream &os,
+    const memory::Memory &mem,
+    std::size_t top_count
+) const
+{
+    const auto flags     = os.flags();
+    const auto precision = os.precision();
+    os << std::fixed << std::setprecision( 2 );
+
+    const auto level = [ &os ]( const char *name, const Cache &cache )
+    {
+        const auto &config = cache.get_config();
+        const char *const policy_str =
+                config.policy == policy_e::lru  ? "lru"
+              : config.policy == policy_e::fifo ? "fifo"
+                                                : "random";
+
+        os << "cache: level: " << name
+           << ", size: " << config.size
+           << ", assoc: " << config.assoc
+           << ", line_size: " << config.line_size
+           << ", policy: " << policy_str
+           << ", accesses: " << cache.get_access_count()
+           << ", misses: " << cache.get_miss_count()
+           << ", miss_rate: "
+           << rate( cache.get_miss_count(), cache.get_access_count() ) << "%"
+           << std::endl;
+    };
+    level( "l1i", this->l1i );
+    level( "l1d", this->l1d );
+    level( "l2", this->l2 );
+
+    // most L1 misses first; ties by address, for a stable report
+    std::vector< addr_t > pc_vec;
+    for ( std::size_t i_ = 0;  i_ < this->pc_stat_vec.size();  ++i_ ) {
+        const auto &stat = this->pc_stat_vec[ i_ ];
+        if ( stat.l1i_miss_count || stat.l1d_miss_count ) {
+            pc_vec.push_back( i_ * iword_size );
+        }
+    }
+    const auto l1_miss_count = [ this ]( addr_t pc )
+    {
+        const auto &stat = this->pc_stat_vec[ pc / iword_size ];
+
+        return stat.l1i_miss_count + stat.l1d_miss_count;
+    };
+    report::keep_top( pc_vec, top_count, l1_miss_count );
+
+    for ( const auto pc : pc_vec ) {
+        const auto &stat = this->pc_stat_vec[ pc / iword_size ];
+
+        os << "cache: pc: " << std::hex << std::showbase << pc
+           << std::dec << std::noshowbase
+           << ", l1i_misses: " << stat.l1i_miss_count
+           << ", l1d_accesses: " << stat.l1d_access_count
+           << ", l1d_misses: " << stat.l1d_miss_count
+           << ", l1d_miss_rate: "
+           << rate( stat.l1d_miss_count, stat.l1d_access_count ) << "%"
+           << ", l2_misses: " << stat.l2_miss_count;
+        report::print_pc( os, mem, pc );
+        os << std::endl;
+    }
+
+    os.flags( flags );
+    os.precision( precision );
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+level_e
+Hierarchy::access_data(
+    addr_t pc,
+    addr_t addr,
+    addr_t size
+)
+{
+    auto *const stat = this->pc_stat( pc );
+    if ( stat ) { ++stat->l1d_access_count; }
+
+    const auto access_line = [ this, stat ]( addr_t addr_ )
+    {
+        if ( this->l1d.access( addr_ ) ) { return level_e::l1; }
+
+        const bool l2_hit = this->l2.access( addr_ );
+        if ( stat ) {
+            ++stat->l1d_miss_count;
+            stat->l2_miss_count += !l2_hit;
+        }
+
+        return l2_hit ? level_e::l2 : level_e::mem;
+    };
+
+    // the last byte's line too, if another
+    const addr_t line_mask = ~addr_t( this->l1d.get_config().line_size - 1 );
+    const addr_t last = addr + (size - 1);
+    const level_e level = access_line( addr );
+    if ( (addr & line_mask) == (last & line_mask) ) { return level; }
+
+    return std::max( level, access_line( last ) );
+}
+
+Hierarchy::pc_stat_t *
+Hierarchy::pc_stat(
+    addr_t pc
+)
+{
+    const std::size_t index = pc / iword_size;
+
+    return index < this->pc_stat_vec.size() ? &this->pc_stat_vec[ index ]
+                                            : nullptr;
+}
+
+
+
+// FUNCTION DEFINITIONS
+
+hierarchy_config_t
+parse_hierarchy_config(
+    const std::string &spec
+)
+{
+    hierarchy_config_t config;
+    if ( spec == "default" ) { return config; }
+
+    std::istringstream spec_ss( spec );
+    for ( std::string level_str;  std::getline( spec_ss, level_str, ',' ); ) {
+        std::istringstream level_ss( level_str );
+        std::vector< std::string > field_vec;
+        for ( std::string field;  std::getline( level_ss, field, ':' ); ) {
+            field_vec.push_back( field );
+        }
+        if ( field_vec.size() < 4 || field_vec.size() > 5 ) {
+            throw std::invalid_argument(
+                    "Malformed cache level: '" + level_str + "'." );
+        }
+
+        cache_config_t *level = nullptr;
+        if      ( field_vec[ 0 ] == "l1i" ) { level = &config.l1i; }
+        else if ( field_vec[ 0 ] == "l1d" ) { level = &config.l1d; }
+        else if ( field_vec[ 0 ] == "l2"  ) { level = &config.l2;  }
+        else {
+            throw std::invalid_argument(
+                    "Unknown cache level: '" + field_vec[ 0 ] + "'." );
+        }
+
+        level->size      = parse_size( field_vec[ 1 ] );
+        level->assoc     = std::stoull( field_vec[ 2 ], nullptr, 0 );
+        level->line_size = parse_size( field_vec[ 3 ] );
+        level->policy    = policy_e::lru;
+        if ( field_vec.size() == 5 ) {
+            const auto &policy_str = field_vec[ 4 ];
+            auto &policy = level->policy;
+            if      ( policy_str == "lru"    ) { policy = policy_e::lru;    }
+            else if ( policy_str == "fifo"   ) { policy = policy_e::fifo;   }
+            else if ( policy_str == "random" ) { policy = policy_e::random; }
+            else {
+                throw std::invalid_argument(
+                        "Unknown cache policy: '" + policy_str + "'." );
+            }
+        }
+    }
+
+    return config;
+}
+
+}  // END namespace cpu_emu::cache
@@ -0,0 +1,158 @@
+#pragma once
+
+// cache model
+
+
+
+// INCLUDES
+
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+
+namespace cpu_emu::cache {
+
+// ENUM CLASS DEFINITIONS
+
+enum class policy_e
+{
+    lru,     // least recently used
+    fifo,    // first in, first out; hits do not reorder
+    random,  // a pseudo-random way; deterministic
+};  // END enum class policy_e
+
+enum class level_e
+{
+    l1,
+    l2,
+    mem,  // missed every level
+};  // END enum class level_e
+
+
+
+// STRUCT DEFINITIONS
+
+struct cache_config_t
+{
+    std::size_t size;       // in bytes; a power of two
+    std::size_t assoc;      // ways per set; divides `size / line_size`
+    std::size_t line_size;  // in bytes; a power of two
+    policy_e    policy;
+};  // END struct cache_config_t
+
+struct hierarchy_config_t
+{
+    cache_config_t l1i = { 0x4000, 4, 32, policy_e::lru };
+    cache_config_t l1d = { 0x4000, 4, 32, policy_e::lru };
+    cache_config_t l2  = { 0x40000, 8, 64, policy_e::lru };
+};  // END struct hierarchy_config_t
+
+
+
+// CLASS DEFINITIONS
+
+// One set-associative level. Each set keeps its tags in replacement order,
+// the next victim last, so no per-line state besides the tag is needed.
+class Cache final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    using addr_t = isa::addr_t;
+    static constexpr std::uint32_t invalid_tag = ~std::uint32_t( 0 );
+
+
+// DATA MEMBERS
+private:
+    cache_config_t config;
+    unsigned       line_length;  // log2 of `line_size`
+    std::size_t    set_mask;
+    std::vector< std::uint32_t > tag_vec;  // by set, then way; line numbers
+    std::uint32_t  random_state = 1;  // xorshift32
+    std::uint64_t  access_count = 0;
+    std::uint64_t  miss_count   = 0;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    explicit Cache( const cache_config_t &config );  // throws if malformed
+    ~Cache();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    bool access( addr_t addr );  // returns whether it hit; fills on a miss
+    const cache_config_t &get_config() const;
+    std::uint64_t get_access_count() const;
+    std::uint64_t get_miss_count() const;
+};  // END class Cache
+
+// Split L1 instruction and data caches backed by a unified L2, counting hits
+// and misses per level and per guest pc. Stores allocate like loads; since
+// no timing is modeled, write-backs are not either. An access crossing a
+// line boundary accesses both lines.
+class Hierarchy final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    using addr_t = isa::addr_t;
+
+    struct pc_stat_t
+    {
+        std::uint64_t l1i_miss_count;
+        std::uint64_t l1d_access_count;
+        std::uint64_t l1d_miss_count;
+        std::uint64_t l2_miss_count;  // of fetches and data accesses
+    };  // END struct pc_stat_t
+
+
+// DATA MEMBERS
+private:
+    Cache l1i;
+    Cache l1d;
+    Cache l2;
+    std::vector< pc_stat_t > pc_stat_vec;  // by pc / 4; within the memory
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Hierarchy( const hierarchy_config_t &config, addr_t mem_size );
+    ~Hierarchy();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    // Each returns the level that served the access; the slower of the two
+    // lines, if crossing.
+    level_e fetch( addr_t pc );
+    level_e load( addr_t pc, addr_t addr, addr_t size );
+    level_e store( addr_t pc, addr_t addr, addr_t size );
+    // per-level rates, then the `top_count` pcs with the most L1 misses
+    void report( std::ostream &os, const memory::Memory &mem,
+                 std::size_t top_count ) const;
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    level_e access_data( addr_t pc, addr_t addr, addr_t size );
+    pc_stat_t *pc_stat( addr_t pc );  // `nullptr` outside the memory
+};  // END class Hierarchy
+
+
+
+// FUNCTION DECLARATIONS
+
+// Parses comma-separated `<level>:<size>:<assoc>:<line_size>[:<policy>]`
+// overrides of the default configuration; e.g., `l2:512k:16:64:fifo`.
+// `<level>` is `l1i`, `l1d`, or `l2`; `<size>` may end in `k` or `m`;
+// `<policy>` is `lru` (the default), `fifo`, or `random`. `default` parses
+// to the default configuration. Throws on malformed specifications.
+hierarchy_config_t parse_hierarchy_config( const std::string &spec );
+
+}  // END namespace cpu_emu::cache
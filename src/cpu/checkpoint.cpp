@@ -0,0 +1,199 @@
+// checkpoint
+
+
+
+// INCLUDES
+
+#include "checkpoint.hpp"
+
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <zlib.h>  // gzopen, gzwrite, gzread, gzclose
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+using namespace cpu_emu::checkpoint;
+using cpu_emu::memory::Memory;
+
+
+
+// STRUCT DEFINITIONS
+
+// Each frame is a gzip member of this header and then, per page, its index
+// as 4 bytes and its contents; in host byte order, like the memory image.
+// Appended members read as one stream.
+struct header_t
+{
+    char          magic_carr[ 8 ];
+    std::uint64_t step_count;
+    std::uint64_t time_ns;
+    addr_t        pc_reg;
+    addr_t        mem_size;
+    addr_t        page_count;
+    word_t        reg_carr[ reg_count ];
+};  // END struct header_t
+
+
+
+// CONSTEXPR DEFINITIONS
+
+constexpr char magic_carr[ 8 ] = { 'R', 'V', '3', '2', 'C', 'K', 'P', '1' };
+
+
+
+// FUNCTION DEFINITIONS
+
+std::size_t
+page_count(
+    const Memory &mem
+)
+{
+    return mem.get_dirty_vec().size();
+}
+
+std::size_t
+page_length(
+    const Memory &mem,
+    addr_t page
+)
+{
+    const std::size_t offset = std::size_t( page ) << Memory::page_length;
+
+    return std::min< std::size_t >( Memory::page_size,
+                                     mem.get_mem_size() - offset );
+}
+
+}  // END namespace
+
+
+
+namespace cpu_emu::checkpoint {
+
+// FUNCTION DEFINITIONS
+
+void
+write(
+    const std::string &file_path,
+    const state_t &state,
+    const memory::Memory &mem,
+    const std::vector< isa::addr_t > &page_vec
+)
+{
+    const bool full = page_vec.size() == page_count( mem );
+    gzFile file = gzopen( file_path.c_str(), full ? "wb1" : "ab1" );
+    if ( !file ) {
+        throw std::runtime_error( "Could not open '" + file_path + "'." );
+    }
+
+    header_t header{};
+    std::memcpy( header.magic_carr, magic_carr, sizeof( magic_carr ) );
+    header.step_count = state.step_count;
+    header.time_ns    = state.time_ns;
+    header.pc_reg     = state.pc_reg;
+    header.mem_size   = mem.get_mem_size();
+    header.page_count = page_vec.size();
+    std::copy( state.reg_arr.begin(), state.reg_arr.end(), header.reg_carr );
+
+    bool ok = gzwrite( file, &header, sizeof( header ) ) == sizeof( header );
+    for ( auto it = page_vec.begin();  ok && it != page_vec.end();  ++it ) {
+        const addr_t page   = *it;
+        const auto   length = page_length( mem, page );
+
+        ok = gzwrite( file, &page, sizeof( page ) ) == sizeof( page )
+          && gzwrite( file, mem.get_mem_carr( page << Memory::page_length ),
+                      length ) == int( length );
+    }
+
+    if ( gzclose( file ) != Z_OK || !ok ) {
+        throw std::runtime_error( "Could not write '" + file_path + "'." );
+    }
+}
+
+std::size_t
+read(
+    const std::string &file_path,
+    state_t &state,
+    memory::Memory &mem
+)
+{
+    gzFile file = gzopen( file_path.c_str(), "rb" );
+    if ( !file ) {
+        throw std::runtime_error( "Could not open '" + file_path + "'." );
+    }
+
+    std::size_t frame_count = 0;
+    try {
+        const auto fail = [ &file_path ]( const char *what )
+        {
+            throw std::runtime_error( std::string( what ) + ": '"
+                                    + file_path + "'." );
+        };
+
+        for ( header_t header;  ;  ++frame_count ) {
+            const int size = gzread( file, &header, sizeof( header ) );
+            if ( !size && frame_count ) { break; }  // end of the last frame
+            if (
+                size != sizeof( header )
+             || std::memcmp( header.magic_carr, magic_carr,
+                             sizeof( magic_carr ) )
+            ) {
+                fail( "Not a checkpoint" );
+            }
+            if ( header.mem_size != mem.get_mem_size() ) {
+                fail( "Checkpoint of another memory size" );
+            }
+            if ( !frame_count && header.page_count != page_count( mem ) ) {
+                fail( "Checkpoint without a full first frame" );
+            }
+
+            for ( addr_t page_ = 0;  page_ < header.page_count;  ++page_ ) {
+                addr_t page;
+                if (
+                    gzread( file, &page, sizeof( page ) ) != sizeof( page )
+                 || page >= page_count( mem )
+                ) {
+                    fail( "Malformed checkpoint" );
+                }
+
+                const auto length = page_length( mem, page );
+                const addr_t addr = page << Memory::page_length;
+                if (
+                    gzread( file, mem.get_mem_carr_nc( addr ), length )
+                 != int( length )
+                ) {
+                    fail( "Malformed checkpoint" );
+                }
+                mem.mark_dirty( addr, length );
+            }
+
+            std::copy( header.reg_carr, header.reg_carr + reg_count,
+                       state.reg_arr.begin() );
+            state.pc_reg     = header.pc_reg;
+            state.step_count = header.step_count;
+            state.time_ns    = header.time_ns;
+        }
+    }
+    catch ( ... ) {
+        gzclose( file );
+        throw;
+    }
+    gzclose( file );
+
+    return frame_count;
+}
+
+}  // END namespace cpu_emu::checkpoint
@@ -0,0 +1,48 @@
+#pragma once
+
+// checkpoint
+
+
+
+// INCLUDES
+
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+
+namespace cpu_emu::checkpoint {
+
+// STRUCT DEFINITIONS
+
+// The architectural state of a `Cpu` besides memory; the counter CSRs
+// follow from `step_count` and `time_ns`.
+struct state_t
+{
+    isa::reg_arr_t reg_arr;
+    isa::addr_t    pc_reg;
+    std::uint64_t  step_count;
+    std::uint64_t  time_ns;  // of the `time` CSR
+};  // END struct state_t
+
+
+
+// FUNCTION DECLARATIONS
+
+// A checkpoint file is a sequence of frames, each with a state and some
+// pages of memory. A frame of every page starts the file afresh; any other
+// frame is appended, and holds the pages dirtied since the previous frame.
+void write( const std::string &file_path, const state_t &state,
+            const memory::Memory &mem,
+            const std::vector< isa::addr_t > &page_vec );
+// Replays every frame into `mem`, marking the written pages dirty, and
+// returns the frame count; `state` is that of the last frame.
+std::size_t read( const std::string &file_path, state_t &state,
+                  memory::Memory &mem );
+
+}  // END namespace cpu_emu::checkpoint
@@ -0,0 +1,146 @@
+// code map
+
+
+
+// INCLUDES
+
+#include "code_map.hpp"
+
+#include "isa.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+
+namespace cpu_emu::cpu {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Code_map::Code_map()
+{}
+
+Code_map::~Code_map()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+void
+Code_map::resize(
+    addr_t mem_size
+)
+{
+    const std::size_t page_count =
+            (std::size_t( mem_size ) + (std::size_t( 1 ) << page_length) - 1)
+         >> page_length;
+    if ( page_count == this->page_vec.size() ) { return; }
+
+    this->page_vec.assign( page_count, 0 );
+    this->range_vec_vec.assign( page_count, {} );
+}
+
+void
+Code_map::add(
+    const range_t &range
+)
+{
+    const auto [ first, end ] =
+            this->page_range( range.pc, range.end_pc - range.pc );
+    for ( std::size_t page_ = first;  page_ < end;  ++page_ ) {
+        this->range_vec_vec[ page_ ].push_back( range );
+        this->page_vec[ page_ ] = 1;
+    }
+}
+
+void
+Code_map::remove(
+    const range_t &range
+)
+{
+    const auto [ first, end ] =
+            this->page_range( range.pc, range.end_pc - range.pc );
+    for ( std::size_t page_ = first;  page_ < end;  ++page_ ) {
+        auto &range_vec = this->range_vec_vec[ page_ ];
+        range_vec.erase(
+                std::remove_if( range_vec.begin(), range_vec.end(),
+                        [ &range ]( const range_t &range_ )
+                        { return range_.pc == range.pc; } ),
+                range_vec.end() );
+        this->page_vec[ page_ ] = !range_vec.empty();
+    }
+}
+
+bool
+Code_map::is_code(
+    addr_t addr,
+    addr_t size
+) const
+{
+    const auto [ first, end ] = this->page_range( addr, size );
+    for ( std::size_t page_ = first;  page_ < end;  ++page_ ) {
+        if ( this->page_vec[ page_ ] ) { return true; }
+    }
+
+    return false;
+}
+
+void
+Code_map::find(
+    addr_t addr,
+    addr_t size,
+    std::vector< addr_t > &pc_vec
+) const
+{
+    const std::size_t end_addr = std::size_t( addr ) + size;
+    const auto [ first, end ] = this->page_range( addr, size );
+    for ( std::size_t page_ = first;  page_ < end;  ++page_ ) {
+        for ( const auto &range : this->range_vec_vec[ page_ ] ) {
+            // blocks spanning two pages are listed on both
+            if (
+                range.pc < end_addr && range.end_pc > addr
+             && std::find( pc_vec.begin(), pc_vec.end(), range.pc )
+                    == pc_vec.end()
+            ) {
+                pc_vec.push_back( range.pc );
+            }
+        }
+    }
+}
+
+const Code_map::uint8_t *
+Code_map::get_page_carr() const
+{
+    return this->page_vec.data();
+}
+
+void
+Code_map::clear()
+{
+    std::fill( this->page_vec.begin(), this->page_vec.end(), 0 );
+    for ( auto &range_vec : this->range_vec_vec ) { range_vec.clear(); }
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+std::pair< std::size_t, std::size_t >
+Code_map::page_range(
+    addr_t addr,
+    addr_t size
+) const
+{
+    const std::size_t page_count = this->page_vec.size();
+    const std::size_t first = addr >> page_length;
+    const std::size_t end   = size
+            ? ((std::size_t( addr ) + size - 1) >> page_length) + 1
+            : first;
+
+    return { std::min( first, page_count ), std::min( end, page_count ) };
+}
+
+}  // END namespace cpu_emu::cpu
@@ -0,0 +1,72 @@
+#pragma once
+
+// code map
+
+
+
+// INCLUDES
+
+#include "defines.h"
+#include "isa.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+
+namespace cpu_emu::cpu {
+
+// CLASS DEFINITIONS
+
+// Tracks the guest address ranges of translated blocks by page, so that a
+// store can tell cheaply whether it hits translated code (a flag per page,
+// also tested by generated code) and, if so, exactly which blocks.
+class Code_map final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    static constexpr unsigned page_length = MEM_PAGE_LENGTH;
+    using addr_t  = isa::addr_t;
+    using uint8_t = isa::uint8_t;
+
+    struct range_t
+    {
+        addr_t pc;      // of the block; identifies it
+        addr_t end_pc;  // past the last instruction
+    };  // END struct range_t
+
+
+// DATA MEMBERS
+private:
+    std::vector< uint8_t > page_vec;  // set if any block overlaps the page
+    std::vector< std::vector< range_t > > range_vec_vec;  // by page
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Code_map();
+    ~Code_map();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    void resize( addr_t mem_size );  // clears; no-op if already this size
+    void add( const range_t &range );  // within the memory
+    void remove( const range_t &range );
+    bool is_code( addr_t addr, addr_t size ) const;
+    // appends the blocks overlapping `[addr, addr + size)`; each once
+    void find( addr_t addr, addr_t size,
+               std::vector< addr_t > &pc_vec ) const;
+    const uint8_t *get_page_carr() const;
+    void clear();
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    // `[first, end)` pages of `[addr, addr + size)`; within the memory
+    std::pair< std::size_t, std::size_t > page_range( addr_t addr,
+                                                      addr_t size ) const;
+};  // END class Code_map
+
+}  // END namespace cpu_emu::cpu
@@ -0,0 +1,372 @@
+// console
+
+
+
+// INCLUDES
+
+#include "console.hpp"
+
+#include "isa.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <unistd.h>  // read, write
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+
+
+
+// FUNCTION DEFINITIONS
+
+// Writes all of `str`; retries partial writes and interrupts.
+void
+write_all(
+    int fd,
+    std::string_view str
+)
+{
+    while ( !str.empty() ) {
+        const auto count = ::write( fd, str.data(), str.size() );
+        if ( count == -1 ) {
+            if ( errno == EINTR ) { continue; }
+            throw std::system_error( errno, std::system_category() );
+        }
+        str.remove_prefix( count );
+    }
+}
+
+bool
+is_space(
+    int c
+)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');  // as in the "C" locale
+}
+
+bool
+is_digit(
+    int c
+)
+{
+    return c >= '0' && c <= '9';
+}
+
+}  // END namespace
+
+
+
+namespace cpu_emu::console {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Console::Console():
+    in_fd( STDIN_FILENO ),
+    out_fd( STDOUT_FILENO ),
+    err_fd( STDERR_FILENO )
+{
+    this->out_buf.reserve( buffer_size );
+}
+
+Console::Console(
+    std::string input
+):
+    in_buf( std::move( input ) )
+{}
+
+Console::Console(
+    Console &&other
+) noexcept:
+    in_fd( other.in_fd ),
+    out_fd( other.out_fd ),
+    err_fd( other.err_fd ),
+    in_buf( std::move( other.in_buf ) ),
+    in_pos( other.in_pos ),
+    in_fail( other.in_fail ),
+    out_buf( std::move( other.out_buf ) ),
+    err_buf( std::move( other.err_buf ) )
+{
+    // the moved-from console must not flush anything on destruction
+    other.in_fd = other.out_fd = other.err_fd = -1;
+    other.out_buf.clear();
+    other.err_buf.clear();
+}
+
+Console &
+Console::operator=(
+    Console &&other
+) noexcept
+{
+    if ( this == &other ) { return *this; }
+
+    try {
+        this->flush();
+    }
+    catch ( ... ) {}  // nowhere to report it; as in `~Console`
+
+    this->in_fd   = other.in_fd;
+    this->out_fd  = other.out_fd;
+    this->err_fd  = other.err_fd;
+    this->in_buf  = std::move( other.in_buf );
+    this->in_pos  = other.in_pos;
+    this->in_fail = other.in_fail;
+    this->out_buf = std::move( other.out_buf );
+    this->err_buf = std::move( other.err_buf );
+
+    other.in_fd = other.out_fd = other.err_fd = -1;
+    other.out_buf.clear();
+    other.err_buf.clear();
+
+    return *this;
+}
+
+Console::~Console()
+{
+    try {
+        this->flush();
+    }
+    catch ( ... ) {}  // e.g., the output was closed
+}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+bool
+Console::read_word(
+    word_t &word
+)
+{
+    if ( this->in_fail ) { return false; }
+
+    int c;
+    while ( is_space( c = this->peek() ) ) { ++this->in_pos; }
+
+    // like `std::num_get`, a negative value wraps around
+    bool negative = false;
+    if ( c == '+' || c == '-' ) {
+        negative = c == '-';
+        ++this->in_pos;
+        c = this->peek();
+    }
+    if ( !is_digit( c ) ) {
+        this->in_fail = true;
+
+        return false;
+    }
+
+    std::uint64_t value = 0;
+    bool overflow = false;
+    for ( ;  is_digit( c );  ++this->in_pos, c = this->peek() ) {
+        value = value * 10 + (c - '0');
+        if ( value > word_t( -1 ) ) { overflow = true;  value = 0; }
+    }
+    if ( overflow ) {
+        this->in_fail = true;
+
+        return false;
+    }
+    word = negative ? -word_t( value ) : word_t( value );
+
+    // skip the rest of the line
+    while ( (c = this->peek()) != -1 ) {
+        ++this->in_pos;
+        if ( c == '\n' ) { break; }
+    }
+
+    return true;
+}
+
+bool
+Console::read_line(
+    char *carr,
+    std::size_t size
+)
+{
+    if ( this->in_fail || !size ) {
+        this->in_fail = true;
+
+        return false;
+    }
+
+    std::size_t count = 0;
+    for ( ;; ) {
+        const int c = this->peek();
+        if ( c == -1 ) {
+            this->in_fail = !count;
+
+            break;
+        }
+        ++this->in_pos;
+        if ( c == '\n' ) { break; }
+        if ( count == size - 1 ) {
+            --this->in_pos;  // not extracted
+            this->in_fail = true;
+
+            break;
+        }
+        carr[ count++ ] = c;
+    }
+    carr[ count ] = '\0';
+
+    return !this->in_fail;
+}
+
+void
+Console::write(
+    channel_e channel,
+    std::string_view str
+)
+{
+    this->begin_write( channel ).append( str );
+    this->end_write( channel );
+}
+
+void
+Console::write_hex(
+    channel_e channel,
+    word_t word,
+    std::size_t width
+)
+{
+    constexpr std::size_t digit_count = sizeof( word_t ) * 2;
+
+    // like `std::showbase`, zero has no base prefix
+    char carr[ 2 + digit_count ];
+    char *digit_carr = carr + sizeof( carr );
+    do {
+        *--digit_carr = "0123456789abcdef"[ word & 0xf ];
+        word >>= 4;
+    } while ( word );
+    const std::string_view digit_str(
+            digit_carr, carr + sizeof( carr ) - digit_carr );
+    const std::string_view base_str = digit_str != "0" ? "0x" : "";
+
+    // like `std::internal`, the fill goes between the base and the digits
+    const std::size_t length = base_str.size() + digit_str.size();
+    auto &buf = this->begin_write( channel );
+    buf.append( base_str );
+    if ( width > length ) { buf.append( width - length, ' ' ); }
+    buf.append( digit_str );
+    this->end_write( channel );
+}
+
+void
+Console::flush()
+{
+    this->flush( channel_e::out );
+    this->flush( channel_e::err );
+}
+
+const std::string &
+Console::get_out_str() const
+{
+    return this->out_buf;
+}
+
+const std::string &
+Console::get_err_str() const
+{
+    return this->err_buf;
+}
+
+std::size_t
+Console::get_in_pos() const
+{
+    return this->in_pos;
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+int
+Console::peek()
+{
+    if ( this->in_pos < this->in_buf.size() ) {
+        return static_cast< unsigned char >( this->in_buf[ this->in_pos ] );
+    }
+    if ( this->in_fd == -1 ) { return -1; }
+
+    // about to block; the guest may be waiting on a prompt
+    this->flush();
+
+    this->in_buf.resize( buffer_size );
+    this->in_pos = 0;
+    for ( ;; ) {
+        const auto count =
+                ::read( this->in_fd, this->in_buf.data(), buffer_size );
+        if ( count == -1 && errno == EINTR ) { continue; }
+
+        this->in_buf.resize( count > 0 ? count : 0 );  // errors end the input
+
+        break;
+    }
+
+    return this->in_buf.empty()
+         ? -1
+         : static_cast< unsigned char >( this->in_buf[ 0 ] );
+}
+
+std::string &
+Console::buffer(
+    channel_e channel
+)
+{
+    return channel == channel_e::out ? this->out_buf : this->err_buf;
+}
+
+std::string &
+Console::begin_write(
+    channel_e channel
+)
+{
+    // keep the order of output interleaved between the channels
+    this->flush( channel == channel_e::out ? channel_e::err : channel_e::out );
+
+    return this->buffer( channel );
+}
+
+void
+Console::end_write(
+    channel_e channel
+)
+{
+    if ( this->buffer( channel ).size() >= buffer_size ) {
+        this->flush( channel );
+    }
+}
+
+void
+Console::flush(
+    channel_e channel
+)
+{
+    const int fd = channel == channel_e::out ? this->out_fd : this->err_fd;
+    auto &buf = this->buffer( channel );
+
+    if ( fd == -1 || buf.empty() ) { return; }
+
+    // the buffer is emptied even if writing fails, so as not to repeat it
+    try {
+        write_all( fd, buf );
+    }
+    catch ( ... ) {
+        buf.clear();
+        throw;
+    }
+    buf.clear();
+}
+
+}  // END namespace cpu_emu::console
@@ -0,0 +1,93 @@
+#pragma once
+
+// console
+
+
+
+// INCLUDES
+
+#include "defines.h"
+#include "isa.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+
+
+namespace cpu_emu::console {
+
+// ENUM CLASS DEFINITIONS
+
+enum class channel_e
+{
+    out,  // standard output
+    err,  // standard error
+};  // END enum class channel_e
+
+
+
+// CLASS DEFINITIONS
+
+// The guest console; see `Cpu::ecall`.
+// Output is buffered, and written out when a buffer fills up, before input
+// is read, before the other channel is written to, and on `flush`.
+// An in-memory console reads a given input and keeps all of its output.
+class Console final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    static constexpr std::size_t buffer_size = CONSOLE_BUFFER_SIZE;
+    using word_t = isa::word_t;
+
+
+// DATA MEMBERS
+private:
+    int         in_fd   = -1;  // -1: in memory
+    int         out_fd  = -1;
+    int         err_fd  = -1;
+    std::string in_buf;
+    std::size_t in_pos  = 0;     // next unread character of `in_buf`
+    bool        in_fail = false;  // sticky, like `std::istream::fail`
+    std::string out_buf;
+    std::string err_buf;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Console();  // standard streams
+    explicit Console( std::string input );  // in memory
+    Console( const Console & ) = delete;
+    Console( Console &&other ) noexcept;
+    Console &operator=( const Console & ) = delete;
+    Console &operator=( Console &&other ) noexcept;
+    ~Console();  // flushes
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    // Parses a decimal word like `std::cin >> word`, then skips the rest of
+    // the line; returns false on failure.
+    bool read_word( word_t &word );
+    // Reads a line like `std::cin.getline( carr, size )`; returns false on
+    // failure, e.g., if the line does not fit.
+    bool read_line( char *carr, std::size_t size );
+    void write( channel_e channel, std::string_view str );
+    // like `std::hex` with `std::showbase`, `std::internal`, and `std::setw`
+    void write_hex( channel_e channel, word_t word, std::size_t width = 0 );
+    void flush();
+    const std::string &get_out_str() const;  // in memory; all output
+    const std::string &get_err_str() const;
+    std::size_t get_in_pos() const;  // in memory; input consumed so far
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    int peek();  // -1 on end of input
+    std::string &buffer( channel_e channel );
+    std::string &begin_write( channel_e channel );  // returns the buffer
+    void end_write( channel_e channel );
+    void flush( channel_e channel );
+};  // END class Console
+
+}  // END namespace cpu_emu::console
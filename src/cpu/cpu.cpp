@@ -10,11 +10,17 @@
 #include "defines.h"
 #include "isa.hpp"
 
-#include <iomanip>
-#include <ios>
-#include <iostream>
-#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include <setjmp.h>  // sigsetjmp
 
 
 
@@ -30,15 +36,98 @@ using namespace cpu_emu::isa;
 
 namespace cpu_emu::cpu {
 
+// FUNCTION DEFINITIONS
+
+const char *
+engine_str(
+    engine_e engine
+)
+{
+    switch ( engine ) {
+        case engine_e::interp:    return "interp";
+        case engine_e::threaded:  return "threaded";
+        case engine_e::jit:       return "jit";
+
+        default:  return "?";
+    }
+}
+
+const char *
+stop_str(
+    stop_e stop
+)
+{
+    switch ( stop ) {
+        case stop_e::none:        return "none";
+        case stop_e::step_count:  return "step_count";
+        case stop_e::breakpoint:  return "breakpoint";
+        case stop_e::exit:        return "exit";
+        case stop_e::trap:        return "trap";
+
+        default:  return "?";
+    }
+}
+
+const char *
+trap_str(
+    trap_e trap
+)
+{
+    switch ( trap ) {
+        case trap_e::none:              return "none";
+        case trap_e::fetch_misaligned:  return "fetch_misaligned";
+        case trap_e::fetch_fault:       return "fetch_fault";
+        case trap_e::illegal:           return "illegal";
+        case trap_e::load_fault:        return "load_fault";
+        case trap_e::store_fault:       return "store_fault";
+        case trap_e::ecall:             return "ecall";
+        case trap_e::ebreak:            return "ebreak";
+
+        default:  return "?";
+    }
+}
+
+bool
+parse_engine(
+    const std::string &str,
+    engine_e &engine
+)
+{
+    for (
+        auto engine_ : { engine_e::interp, engine_e::threaded, engine_e::jit }
+    ) {
+        if ( str == engine_str( engine_ ) ) { engine = engine_;  return true; }
+    }
+
+    return false;
+}
+
+
+
 // CONSTRUCTOR, DESTRUCTOR DEFINITIONS
 
 Cpu::Cpu(
     word_t pc_reg,
     word_t sp_reg,
-    const std::string &mem_img_path
+    const std::string &mem_img_path,
+    memory::map_e mem_map
+):
+    pc_reg( pc_reg ),
+    mem_img_path( mem_img_path ),
+    mem_map( mem_map )
+{
+    this->set_sp_reg( sp_reg );
+}
+
+Cpu::Cpu(
+    const memory::Image &image,
+    word_t pc_reg,
+    word_t sp_reg
 ):
     pc_reg( pc_reg ),
-    mem_img_path( mem_img_path )
+    mem_img_path( image.get_file_path() ),
+    mem_map( memory::map_e::copy_on_write ),
+    mem( image )
 {
     this->set_sp_reg( sp_reg );
 }
@@ -76,6 +165,36 @@ Cpu::get_pc_reg() const
     return this->pc_reg;
 }
 
+const engine_e &
+Cpu::get_engine() const
+{
+    return this->engine;
+}
+
+const std::size_t &
+Cpu::get_step_count() const
+{
+    return this->step_count;
+}
+
+const memory::Memory &
+Cpu::get_mem() const
+{
+    return this->mem;
+}
+
+const console::Console &
+Cpu::get_console() const
+{
+    return this->console;
+}
+
+const Profiler *
+Cpu::get_profiler() const
+{
+    return this->profiler.get();
+}
+
 void
 Cpu::set_reg_arr(
     const reg_arr_t &reg_arr
@@ -113,209 +232,429 @@ Cpu::set_pc_reg(
 }
 
 void
-Cpu::step()  // FIX; handle exceptions
+Cpu::set_engine(
+    engine_e engine
+)
 {
-    this->execute( decoder::decode( this->fetch() ) );
+    this->engine = engine;
 }
 
+void
+Cpu::set_console(
+    console::Console &&console
+)
+{
+    this->console = std::move( console );
+}
 
+void
+Cpu::set_profiling(
+    bool enabled
+)
+{
+    this->profiler = enabled ? std::make_unique< Profiler >() : nullptr;
 
-// PRIVATE MEMBER-FUNCTION DEFINITIONS
+    // translated blocks hold pointers to their counters
+    this->decode_cache.clear();
+    this->threaded_engine.clear();
+    this->jit_engine.clear();
+}
 
-iword_t
-Cpu::fetch() const
+void
+Cpu::start_trace(
+    const std::string &file_path
+)
 {
-    return this->load_iword( this->pc_reg );
+    this->stop_trace();
+    this->tracer = std::make_unique< trace::Writer >( file_path );
 }
 
-iword_t
-Cpu::load_iword(
-    addr_t addr
-) const
+std::size_t
+Cpu::stop_trace()
 {
-    return this->mem.lw( addr );
+    if ( !this->tracer ) { return 0; }
+
+    const auto tracer = std::move( this->tracer );
+
+    return tracer->close();
 }
 
 void
-Cpu::execute(
-    instr_t instr
+Cpu::start_cache_model(
+    const cache::hierarchy_config_t &config
 )
 {
-    switch ( instr.opcode ) {
-        case opcode_e::arith_r:  this->arith_r( instr );  break;
-        case opcode_e::load:     this->load( instr );     break;
-        case opcode_e::fence:    this->fence( instr );    break;
-        case opcode_e::arith_i:  this->arith_i( instr );  break;
-        case opcode_e::jalr:     this->jalr( instr );     break;
-        case opcode_e::system:   this->system( instr );   break;
-        case opcode_e::store:    this->store( instr );    break;
-        case opcode_e::branch:   this->branch( instr );   break;
-        case opcode_e::auipc:    this->auipc( instr );    break;
-        case opcode_e::lui:      this->lui( instr );      break;
-        case opcode_e::jal:      this->jal( instr );      break;
-
-        default:  this->_illegal( instr );  break;
-    }
-    this->reg_arr[ 0 ] = this->reg_0_value;  // restore reg_0 value
+    this->cache_model = std::make_unique< cache::Hierarchy >(
+            config, this->mem.get_mem_size() );
+}
 
-    // increment pc if no jump/branch
-    switch ( instr.mnem ) {
-    // jal
-        case mnem_e::JAL:
-    // jalr
-        case mnem_e::JALR:
-    // branch
-        case mnem_e::BEQ:
-        case mnem_e::BNE:
-        case mnem_e::BLT:
-        case mnem_e::BGE:
-        case mnem_e::BLTU:
-        case mnem_e::BGEU:
-            return;  // jump/branch
-
-        default:  break;
-    }
-    // no jump/branch
-    this->pc_reg += this->iword_length >> 3;
+const cache::Hierarchy *
+Cpu::get_cache_model() const
+{
+    return this->cache_model.get();
 }
 
 void
-Cpu::arith_r(
-    instr_t instr
+Cpu::start_branch_model(
+    branch::predictor_e predictor
 )
 {
-    auto      &rd  = this->reg_arr[ instr.rd ];
-    const auto rs1 = this->reg_arr[ instr.rs1 ];
-    const auto rs2 = this->reg_arr[ instr.rs2 ];
-
-    switch ( instr.mnem ) {
-        case mnem_e::ADD:   rd = rs1 + rs2;                              break;
-        case mnem_e::SUB:   rd = rs1 - rs2;                              break;
-        case mnem_e::SLL:   rd = rs1 << word_extract( rs2, 4, 0 );       break;
-        case mnem_e::SLT:   rd = static_cast< sword_t >( rs1 )
-                               < static_cast< sword_t >( rs2 ) ? 1 : 0;  break;
-        case mnem_e::SLTU:  rd = rs1 < rs2 ? 1 : 0;                      break;
-        case mnem_e::XOR:   rd = rs1 ^ rs2;                              break;
-        case mnem_e::SRL:   rd = rs1 >> word_extract( rs2, 4, 0 );       break;
-        case mnem_e::SRA:   rd = static_cast< sword_t >( rs1 )
-                                     >> word_extract( rs2, 4, 0 );       break;
-        case mnem_e::OR:    rd = rs1 | rs2;                              break;
-        case mnem_e::AND:   rd = rs1 & rs2;                              break;
-
-        case mnem_e::_ILLEGAL:
-            throw std::runtime_error( "Illegal arith_r." );  break;
+    this->branch_model = std::make_unique< branch::Model >(
+            predictor, this->mem.get_mem_size() );
+}
 
-        default:  throw std::logic_error( "Should not occur." );  break;
+const branch::Model *
+Cpu::get_branch_model() const
+{
+    return this->branch_model.get();
+}
+
+void
+Cpu::start_timing_model(
+    const pipeline::timing_config_t &config
+)
+{
+    this->timing_model = std::make_unique< pipeline::Model >( config );
+}
+
+const pipeline::Model *
+Cpu::get_timing_model() const
+{
+    return this->timing_model.get();
+}
+
+void
+Cpu::step()
+{
+    this->ran_engine = engine_e::interp;  // see `run_engine`
+    this->guarded( [ this ] { this->step_unguarded(); } );
+}
+
+run_result_t
+Cpu::run(
+    std::size_t max_steps,
+    const stop_conditions_t &stop_conditions
+)
+{
+    // translated blocks end at breakpoints; retranslate if these change
+    auto breakpoint_vec = stop_conditions.breakpoint_vec;
+    std::sort( breakpoint_vec.begin(), breakpoint_vec.end() );
+    if ( breakpoint_vec != this->breakpoint_vec ) {
+        this->breakpoint_vec = std::move( breakpoint_vec );
+        this->decode_cache.clear();
+        this->threaded_engine.clear();
+        this->jit_engine.clear();
     }
+
+    const auto start_step_count = this->step_count;
+    this->stop = stop_e::none;
+    this->trap = {};
+
+    // the guest output is complete whenever the host regains control;
+    // only host errors throw, such as a failed write of the output
+    try {
+        this->guarded( [ this, max_steps ] { this->run_engine( max_steps ); } );
+    }
+    catch ( ... ) {
+        this->console.flush();
+        throw;
+    }
+    this->console.flush();
+
+    if ( this->stop == stop_e::none ) { this->stop = stop_e::step_count; }
+
+    return {
+        this->step_count - start_step_count,
+        this->pc_reg,
+        this->stop,
+        this->exit_status,
+        this->trap
+    };
+}
+
+
+void
+Cpu::snapshot()
+{
+    this->snapshot_reg_arr = this->reg_arr;
+    this->snapshot_pc_reg  = this->pc_reg;
+    this->mem.snapshot();
 }
 
 void
-Cpu::load(
-    instr_t instr
+Cpu::restore()
+{
+    // only the dirtied pages change; drop any code translated from them
+    const auto page_count = this->mem.get_dirty_vec().size();
+    for ( std::size_t page_ = 0;  page_ < page_count;  ++page_ ) {
+        if ( this->mem.is_dirty_since_snapshot( page_ ) ) {
+            this->invalidate( page_ << memory::Memory::page_length,
+                              memory::Memory::page_size );
+        }
+    }
+    this->mem.restore();
+
+    this->reg_arr = this->snapshot_reg_arr;
+    this->pc_reg  = this->snapshot_pc_reg;
+    this->stop    = stop_e::none;
+    this->trap    = {};
+}
+
+std::size_t
+Cpu::checkpoint(
+    const std::string &file_path
 )
 {
-    auto       &rd  = this->reg_arr[ instr.rd ];
-    const auto  rs1 = this->reg_arr[ instr.rs1 ];
-    const auto &mem = this->mem;
+    auto page_vec = this->mem.take_checkpoint_pages();
+    if ( file_path != this->checkpoint_path ) {
+        page_vec.resize( this->mem.get_dirty_vec().size() );
+        for ( std::size_t page_ = 0;  page_ < page_vec.size();  ++page_ ) {
+            page_vec[ page_ ] = page_;
+        }
+    }
+
+    const checkpoint::state_t state{
+        this->reg_arr,
+        this->pc_reg,
+        this->step_count,
+        std::uint64_t( std::chrono::duration_cast< std::chrono::nanoseconds >(
+                std::chrono::steady_clock::now() - this->start_time ).count() )
+    };
+    // a failed write leaves the next checkpoint to this file a full one
+    this->checkpoint_path.clear();
+    checkpoint::write( file_path, state, this->mem, page_vec );
+    this->checkpoint_path = file_path;
+
+    return page_vec.size();
+}
 
-    addr_t addr = rs1 + instr.imm;
+std::size_t
+Cpu::resume(
+    const std::string &file_path
+)
+{
+    checkpoint::state_t state{};
+    this->checkpoint_path.clear();
+    const auto frame_count = checkpoint::read( file_path, state, this->mem );
+
+    // all of memory may have changed
+    this->decode_cache.clear();
+    this->threaded_engine.clear();
+    this->jit_engine.clear();
+
+    this->reg_arr    = state.reg_arr;
+    this->pc_reg     = state.pc_reg;
+    this->step_count = state.step_count;
+    this->start_time = std::chrono::steady_clock::now()
+                     - std::chrono::nanoseconds( state.time_ns );
+    this->stop       = stop_e::none;
+    this->trap       = {};
+
+    // the memory now matches the file
+    this->mem.take_checkpoint_pages();
+    this->checkpoint_path = file_path;
+
+    return frame_count;
+}
 
-    switch ( instr.mnem ) {
-        // static casts needed for automatic sign-extension
-        case mnem_e::LB:   rd = static_cast< int8_t  >( mem.lb( addr ) ); break;
-        case mnem_e::LH:   rd = static_cast< int16_t >( mem.lh( addr ) ); break;
-        case mnem_e::LW:   rd = mem.lw( addr );                           break;
-        case mnem_e::LBU:  rd = mem.lb( addr );                           break;
-        case mnem_e::LHU:  rd = mem.lh( addr );                           break;
 
-        case mnem_e::_ILLEGAL:
-            throw std::runtime_error( "Illegal load." );  break;
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
 
-        default:  throw std::logic_error( "Should not occur." );  break;
+template< typename T_fn >
+void
+Cpu::guarded(
+    T_fn fn
+)
+{
+    this->mem.arm( this->recovery );
+    try {
+        if ( !sigsetjmp( this->recovery.env, 0 ) ) { fn(); }
+        else                                       { this->recover(); }
+    }
+    catch ( ... ) {
+        memory::Memory::disarm( this->recovery );
+        throw;
     }
+    memory::Memory::disarm( this->recovery );
 }
 
 void
-Cpu::fence(
-    instr_t instr
-) const  // FIX; currently no-op
+Cpu::recover()
 {
-    switch ( instr.mnem ) {
-        case mnem_e::FENCE:    break;
-        case mnem_e::FENCE_I:  break;
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    // a block of the threaded engine leaves the step count to it
+    this->threaded_engine.recover( *this );
+    // a profiled block ran up to the access; the trapping step is counted
+    if ( this->profiled_block ) {
+        this->profiler->truncate( *this->profiled_block,
+                                  this->pc_reg + iword_size );
+        this->profiled_block = nullptr;
+    }
 
-        case mnem_e::_ILLEGAL:
-            throw std::runtime_error( "Illegal fence." );  break;
+    // `pc_reg` is at the access, which did not complete; `rd` of a load is
+    // written last, so the address can be recomputed
+    const auto *cached = this->decode_cache.find( this->pc_reg );
+    const auto  instr  = cached ? *cached
+                                : decoder::decode_compact( this->fetch() );
+    const addr_t addr = this->reg_arr[ instr.rs1 ] + instr.imm;
+
+    this->raise_trap(
+        mnem_opcode( instr.mnem ) == opcode_e::store ? trap_e::store_fault
+                                                     : trap_e::load_fault,
+        addr
+    );
+}
 
-        default:  throw std::logic_error( "Should not occur." );  break;
+void
+Cpu::step_unguarded()
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+    const auto pc = this->pc_reg;
+
+    ++this->step_count;
+
+    if ( const auto instr = this->decode_cache.find( pc ) ) {
+        this->execute( *instr );  // copied; `execute` may invalidate the entry
+
+        return;
+    }
+
+    // only fetchable pcs are cached, so hits need no checks
+    if ( pc & (iword_size - 1) ) {
+        this->raise_trap( trap_e::fetch_misaligned, pc );
+
+        return;
+    }
+    if ( !this->mem.is_in_bounds( pc, iword_size ) ) {
+        this->raise_trap( trap_e::fetch_fault, pc );
+
+        return;
     }
+
+    const auto instr = decoder::decode_compact( this->fetch() );
+    this->decode_cache.insert( pc, instr );
+    this->execute( instr );
 }
 
 void
-Cpu::arith_i(
-    instr_t instr
+Cpu::run_engine(
+    std::size_t step_count
 )
 {
-    auto      &rd  = this->reg_arr[ instr.rd ];
-    const auto rs1 = this->reg_arr[ instr.rs1 ];
-    const auto imm = instr.imm;
+    const auto engine = this->is_instrumented() ? engine_e::interp
+                                                : this->engine;
+
+    // the jit checks its own pages only on stores; drop what the interpreter
+    // and the threaded engine hold from before, which it could leave stale
+    if ( engine == engine_e::jit && this->ran_engine != engine_e::jit ) {
+        this->decode_cache.clear();
+        this->threaded_engine.clear();
+    }
+    this->ran_engine = engine;
+
+    switch ( engine ) {
+        case engine_e::interp:
+            this->run_interp( step_count );
+
+            break;
+        case engine_e::threaded:
+            this->threaded_engine.run( *this, step_count );
+
+            break;
+        case engine_e::jit:
+            this->jit_engine.run( *this, step_count );
 
-    switch ( instr.mnem ) {
-        case mnem_e::ADDI:   rd = rs1 + imm;                              break;
-        case mnem_e::SLLI:   rd = rs1 << word_extract( imm, 4, 0 );       break;
-        case mnem_e::SLTI:   rd = static_cast< sword_t >( rs1 )
-                                < static_cast< sword_t >( imm ) ? 1 : 0;  break;
-        case mnem_e::SLTIU:  rd = rs1 < imm ? 1 : 0;                      break;
-        case mnem_e::XORI:   rd = rs1 ^ imm;                              break;
-        case mnem_e::SRLI:   rd = rs1 >> word_extract( imm, 4, 0 );       break;
-        case mnem_e::SRAI:   rd = static_cast< sword_t >( rs1 )
-                                      >> word_extract( imm, 4, 0 );       break;
-        case mnem_e::ORI:    rd = rs1 | imm;                              break;
-        case mnem_e::ANDI:   rd = rs1 & imm;                              break;
-
-        case mnem_e::_ILLEGAL:
-            throw std::runtime_error( "Illegal arith_i." );  break;
+            break;
 
         default:  throw std::logic_error( "Should not occur." );  break;
     }
 }
 
+iword_t
+Cpu::fetch() const
+{
+    return this->load_iword( this->pc_reg );
+}
+
+iword_t
+Cpu::load_iword(
+    addr_t addr
+) const
+{
+    return this->mem.lw( addr );
+}
+
+template< std::size_t... Index >
+constexpr
+std::array< Cpu::exec_fn_t, mnem_count >
+Cpu::make_exec_fn_arr(
+    std::index_sequence< Index... >
+)
+{
+    return { { &Cpu::exec< static_cast< mnem_e >( Index ) >... } };
+}
+
 void
-Cpu::jalr(
-    instr_t instr
+Cpu::execute(
+    cinstr_t instr
 )
 {
-    auto      &pc  = this->pc_reg;
-    auto      &rd  = this->reg_arr[ instr.rd ];
-    const auto rs1 = this->reg_arr[ instr.rs1 ];
+    // a single indexed call; each handler is specialized for its mnem
+    static constexpr auto exec_fn_arr =
+            make_exec_fn_arr( std::make_index_sequence< mnem_count >{} );
 
-    rd = pc + (this->iword_length >> 3);
-    pc = (rs1 + instr.imm) & ~word_mask( 0, 0 );
+    exec_fn_arr[ static_cast< std::size_t >( instr.mnem ) ]( *this, instr );
+    this->reg_arr[ 0 ] = this->reg_0_value;  // restore reg_0 value
 }
 
 void
-Cpu::system(
-    instr_t instr
+Cpu::csr(
+    cinstr_t instr,
+    bool write
 )
 {
-    // auto      &rd  = this->reg_arr[ instr.rd ];
-    // const auto rs1 = this->reg_arr[ instr.rs1 ];
-    // const auto imm = instr.imm;
+    auto      &rd   = this->reg_arr[ instr.rd ];
+    const auto addr = word_extract( instr.imm, 11, 0 );
 
-    switch ( instr.mnem ) {
-        case mnem_e::ECALL:   this->ecall();  break;
-        case mnem_e::EBREAK:                  break;
-        case mnem_e::CSRRW:                   break;
-        case mnem_e::CSRRS:                   break;
-        case mnem_e::CSRRC:                   break;
-        case mnem_e::CSRRWI:                  break;
-        case mnem_e::CSRRSI:                  break;
-        case mnem_e::CSRRCI:                  break;
+    // the counters are read-only
+    std::uint64_t value;
+    if ( write || !this->csr_counter( addr, value ) ) {
+        this->raise_trap( trap_e::illegal, this->fetch() );
 
-        case mnem_e::_ILLEGAL:
-            throw std::runtime_error( "Illegal system." );  break;
+        return;
+    }
 
-        default:  throw std::logic_error( "Should not occur." );  break;
+    rd = addr & 0x80 ? word_t( value >> this->word_length ) : word_t( value );
+    this->pc_reg += this->iword_length >> 3;
+}
+
+bool
+Cpu::csr_counter(
+    word_t addr,
+    std::uint64_t &value
+) const
+{
+    switch ( addr ) {
+        // the step count includes the reading instruction, which has not
+        // retired yet; every instruction takes one cycle
+        case csr_ns::cycle:
+        case csr_ns::cycleh:
+        case csr_ns::instret:
+        case csr_ns::instreth:
+            value = this->step_count - 1;
+
+            return true;
+        // nanoseconds since construction, including any resumed run
+        case csr_ns::time:
+        case csr_ns::timeh:
+            value = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                    std::chrono::steady_clock::now() - this->start_time )
+                    .count();
+
+            return true;
+
+        default:  return false;
     }
 }
 
@@ -331,169 +670,501 @@ Cpu::ecall()
     auto &a5 = this->reg_arr[ reg_idx_ns::a5 ];
     auto &a6 = this->reg_arr[ reg_idx_ns::a6 ];
     auto &a7 = this->reg_arr[ reg_idx_ns::a7 ];
+    // console
+    using console::channel_e;
+    auto &console = this->console;
+    const auto hex_width = (this->word_length >> 2) + 2;
 
     switch ( a7 ) {
         case ECALL_SBRK:
-            std::cout << std::hex << std::showbase;
-            std::cout << "ECALL_SBRK:" << std::endl;
-            std::cout << "  a0: " << a0 << std::endl;
-            std::cout << "  a1: " << a1 << std::endl;
-            std::cout << "  a2: " << a2 << std::endl;
-            std::cout << "  a3: " << a3 << std::endl;
-            std::cout << "  a4: " << a4 << std::endl;
-            std::cout << "  a5: " << a5 << std::endl;
-            std::cout << "  a6: " << a6 << std::endl;
-            std::cout << "  a7: " << a7 << std::endl;
+            console.write( channel_e::out, "ECALL_SBRK:\n" );
+            for (
+                const auto &[ name, arg ]
+              : { std::pair< const char *, word_t >{ "  a0: ", a0 },
+                  { "  a1: ", a1 }, { "  a2: ", a2 }, { "  a3: ", a3 },
+                  { "  a4: ", a4 }, { "  a5: ", a5 }, { "  a6: ", a6 },
+                  { "  a7: ", a7 } }
+            ) {
+                console.write( channel_e::out, name );
+                console.write_hex( channel_e::out, arg );
+                console.write( channel_e::out, "\n" );
+            }
 
             if ( !a0 ) { a0 = HEAP_START_ADDR; }  // init heap start address
             a0 = a0;  // new program break; grant all requests
 
             break;
         case ECALL_IN_WORD:
-            std::cin >> a0;
-            if ( !std::cin ) { throw std::runtime_error( "Input error." ); }
+            // skips the rest of the line
+            if ( !console.read_word( a0 ) ) {
+                this->raise_trap( trap_e::ecall, a7 );
 
-            std::cin.ignore(
-                std::numeric_limits< std::streamsize >::max(),
-                '\n'
-            );  // skip rest of the line
+                return;
+            }
 
             break;
         case ECALL_IN_STR:
-            std::cin.getline(
+        {
+            if ( !this->mem.is_in_bounds( a0, TEST_INPUT_BUFFER_SIZE ) ) {
+                this->raise_trap( trap_e::store_fault, a0 );
+
+                return;
+            }
+            const bool ok = console.read_line(
                 reinterpret_cast< char * >( this->mem.get_mem_carr_nc( a0 ) ),
                 TEST_INPUT_BUFFER_SIZE
             );
-            if ( !std::cin ) { throw std::runtime_error( "Input error." ); }
+            this->mem.mark_dirty( a0, TEST_INPUT_BUFFER_SIZE );
+            this->invalidate( a0, TEST_INPUT_BUFFER_SIZE );
+            if ( !ok ) {
+                this->raise_trap( trap_e::ecall, a7 );
+
+                return;
+            }
+        }
 
             break;
         case ECALL_OUT_WORD:
-            std::cout << std::hex << std::showbase
-                      << std::setw( (this->word_length >> 2) + 2 )
-                      << std::setfill( ' ' ) << std::internal;
-            std::cout << a0 << std::endl;
+            console.write_hex( channel_e::out, a0, hex_width );
+            console.write( channel_e::out, "\n" );
 
             break;
         case ECALL_OUT_STR:
-            std::cout << std::setw( 0 );
-            std::cout << reinterpret_cast< const char * >(
-                    this->mem.get_mem_carr( a0 ) ) << std::flush;
+        case ECALL_ERR_STR:
+        {
+            std::string_view str;
+            if ( !this->guest_str( a0, str ) ) {
+                this->raise_trap( trap_e::load_fault, a0 );
 
-            break;
-        case ECALL_ERR_WORD:
-            std::cerr << std::hex << std::showbase
-                      << std::setw( (this->word_length >> 2) + 2 )
-                      << std::setfill( ' ' ) << std::internal;
-            std::cerr << a0 << std::endl;
+                return;
+            }
+            console.write( a7 == ECALL_OUT_STR ? channel_e::out
+                                               : channel_e::err, str );
+        }
 
             break;
-        case ECALL_ERR_STR:
-            std::cerr << std::setw( 0 );
-            std::cerr << reinterpret_cast< const char * >(
-                    this->mem.get_mem_carr( a0 ) ) << std::flush;
+        case ECALL_ERR_WORD:
+            console.write_hex( channel_e::err, a0, hex_width );
+            console.write( channel_e::err, "\n" );
 
             break;
         case ECALL_EXIT:
-            std::exit( a0 );
+            this->stop = stop_e::exit;
+            this->exit_status = a0;
 
-            break;
+            return;  // stays at the ecall
 
-        default:  throw std::runtime_error( "No matching ecall." );  break;
+        default:  this->raise_trap( trap_e::ecall, a7 );  return;
     }
+    this->pc_reg += this->iword_length >> 3;
 }
 
 void
-Cpu::store(
-    instr_t instr
+Cpu::raise_trap(
+    trap_e cause,
+    word_t value
 )
 {
-    const auto rs1 = this->reg_arr[ instr.rs1 ];
-    const auto rs2 = this->reg_arr[ instr.rs2 ];
+    this->trap = { cause, this->pc_reg, value };
+    this->stop = stop_e::trap;
+}
+
+bool
+Cpu::guest_str(
+    addr_t addr,
+    std::string_view &str
+) const
+{
+    if ( !this->mem.is_in_bounds( addr, 1 ) ) { return false; }
 
-    addr_t addr = rs1 + instr.imm;
+    const auto *carr = reinterpret_cast< const char * >(
+            this->mem.get_mem_carr( addr ) );
+    const std::size_t max_size = this->mem.get_mem_size() - addr;
 
-    switch ( instr.mnem ) {
-        case mnem_e::SB:  mem.sb( addr, static_cast< uint8_t  >( rs2 ) ); break;
-        case mnem_e::SH:  mem.sh( addr, static_cast< uint16_t >( rs2 ) ); break;
-        case mnem_e::SW:  mem.sw( addr, rs2 );                            break;
+    // bounded by the end of memory; `memchr` is vectorized by the libc
+    const auto *end = static_cast< const char * >(
+            std::memchr( carr, '\0', max_size ) );
+    if ( !end ) { return false; }
 
-        case mnem_e::_ILLEGAL:
-            throw std::runtime_error( "Illegal store." );  break;
+    str = { carr, std::size_t( end - carr ) };
 
-        default:  throw std::logic_error( "Should not occur." );  break;
-    }
+    return true;
 }
 
 void
-Cpu::branch(
-    instr_t instr
+Cpu::invalidate(
+    addr_t addr,
+    addr_t size
 )
 {
-    auto      &pc  = this->pc_reg;
-    const auto rs1 = this->reg_arr[ instr.rs1 ];
-    const auto rs2 = this->reg_arr[ instr.rs2 ];
-    const auto imm = instr.imm;
+    // drop any cached decode or translation of the written range
+    this->decode_cache.invalidate( addr, size );
+    this->threaded_engine.invalidate( addr, size );
+    this->jit_engine.invalidate( addr, size );
+}
 
-    switch ( instr.mnem ) {
-        case mnem_e::BEQ:   if ( rs1 == rs2 ) { pc += imm;  return; }  break;
-        case mnem_e::BNE:   if ( rs1 != rs2 ) { pc += imm;  return; }  break;
-        case mnem_e::BLT:   if ( static_cast< sword_t >( rs1 )
-                               < static_cast< sword_t >( rs2 ) )
-                                              { pc += imm;  return; }  break;
-        case mnem_e::BGE:   if ( static_cast< sword_t >( rs1 )
-                              >= static_cast< sword_t >( rs2 ) )
-                                              { pc += imm;  return; }  break;
-        case mnem_e::BLTU:  if ( rs1  < rs2 ) { pc += imm;  return; }  break;
-        case mnem_e::BGEU:  if ( rs1 >= rs2 ) { pc += imm;  return; }  break;
-
-        case mnem_e::_ILLEGAL:
-            throw std::runtime_error( "Illegal branch." );  break;
+bool
+Cpu::is_breakpoint(
+    addr_t addr
+) const
+{
+    return std::binary_search(
+        this->breakpoint_vec.begin(),
+        this->breakpoint_vec.end(),
+        addr
+    );
+}
 
-        default:  throw std::logic_error( "Should not occur." );  break;
+void
+Cpu::run_interp(
+    std::size_t step_count
+)
+{
+    if ( this->profiler ) {
+        this->run_interp_profiled( step_count );
+
+        return;
+    }
+    if ( this->is_instrumented() ) {
+        this->run_interp_instrumented( step_count );
+
+        return;
+    }
+
+    // the first step is exempt from breakpoints; see `stop_conditions_t`
+    if ( step_count && this->stop == stop_e::none ) {
+        this->step_unguarded();
+        --step_count;
+    }
+
+    if ( this->breakpoint_vec.empty() ) {
+        for (
+            ;
+            step_count && this->stop == stop_e::none;
+            --step_count
+        ) {
+            this->step_unguarded();
+        }
+
+        return;
+    }
+
+    for (
+        ;
+        step_count && this->stop == stop_e::none;
+        --step_count
+    ) {
+        if ( this->is_breakpoint( this->pc_reg ) ) {
+            this->stop = stop_e::breakpoint;
+
+            break;
+        }
+        this->step_unguarded();
     }
-    // branch not taken
-    pc += this->iword_length >> 3;
 }
 
 void
-Cpu::auipc(
-    instr_t instr
+Cpu::run_interp_profiled(
+    std::size_t step_count
 )
 {
-    const auto pc = this->pc_reg;
-    auto      &rd = this->reg_arr[ instr.rd ];
+    Profiler::block_t *block = nullptr;
+    std::size_t remaining = 0;  // steps left in `block`
+
+    for (
+        bool first_ = true;
+        step_count && this->stop == stop_e::none;
+        --step_count, first_ = false
+    ) {
+        // the first step is exempt from breakpoints; see `stop_conditions_t`
+        if ( !first_ && this->is_breakpoint( this->pc_reg ) ) {
+            this->stop = stop_e::breakpoint;
+
+            break;
+        }
+
+        if ( !remaining ) {
+            const addr_t pc = this->pc_reg;
+
+            block = this->profiler->find_block( pc );
+            if ( !block ) {
+                block = &this->profiler->get_block( pc, this->block_end( pc ) );
+            }
+            ++block->count;
+            remaining = (block->end_pc - pc) / (this->iword_length >> 3);
+            this->profiled_block = block;  // for `recover`
+        }
+
+        if ( this->is_instrumented() ) { this->step_instrumented(); }
+        else                           { this->step_unguarded(); }
+
+        if ( !--remaining && this->pc_reg != block->end_pc ) {
+            ++block->jump_count;
+        }
+    }
+
+    // stopped within the block; by the budget, a breakpoint, or a trap
+    if ( remaining ) {
+        constexpr addr_t iword_size = iword_length >> 3;
+        this->profiler->truncate( *block,
+                                  block->end_pc - remaining * iword_size );
+    }
+    this->profiled_block = nullptr;
+}
+
+addr_t
+Cpu::block_end(
+    addr_t pc
+) const
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+    const addr_t mem_size = this->mem.get_mem_size();
+
+    // like the translated blocks; up to a control transfer or a breakpoint
+    addr_t end_pc = pc;
+    while (
+        (end_pc - pc) / iword_size < BLOCK_MAX_LENGTH
+        && mem_size >= iword_size
+        && end_pc <= mem_size - iword_size
+        && (end_pc == pc || !this->is_breakpoint( end_pc ))
+    ) {
+        const auto mnem =
+                decoder::decode_compact( this->load_iword( end_pc ) ).mnem;
+        end_pc += iword_size;
+
+        switch ( mnem ) {
+            case mnem_e::FENCE_I:
+            case mnem_e::JALR:
+            case mnem_e::ECALL:
+            case mnem_e::EBREAK:
+            case mnem_e::BEQ:
+            case mnem_e::BNE:
+            case mnem_e::BLT:
+            case mnem_e::BGE:
+            case mnem_e::BLTU:
+            case mnem_e::BGEU:
+            case mnem_e::JAL:
+            case mnem_e::_ILLEGAL:
+                return end_pc;
+
+            default:  break;
+        }
+    }
 
-    rd = pc + instr.imm;
+    // at least the instruction at `pc`, even if it faults
+    return end_pc != pc ? end_pc : pc + iword_size;
 }
 
 void
-Cpu::lui(
-    instr_t instr
-)
+Cpu::step_profiled()
 {
-    auto &rd = this->reg_arr[ instr.rd ];
+    const addr_t pc = this->pc_reg;
+    auto &block =
+            this->profiler->get_block( pc, pc + (this->iword_length >> 3) );
+
+    ++block.count;
+    this->step_unguarded();
+    if ( this->pc_reg != block.end_pc ) { ++block.jump_count; }
+}
 
-    rd = instr.imm;
+bool
+Cpu::is_instrumented() const
+{
+    return this->tracer || this->cache_model || this->branch_model
+        || this->timing_model;
 }
 
 void
-Cpu::jal(
-    instr_t instr
+Cpu::run_interp_instrumented(
+    std::size_t step_count
 )
 {
-    auto &pc = this->pc_reg;
-    auto &rd = this->reg_arr[ instr.rd ];
+    for (
+        bool first_ = true;
+        step_count && this->stop == stop_e::none;
+        --step_count, first_ = false
+    ) {
+        // the first step is exempt from breakpoints; see `stop_conditions_t`
+        if ( !first_ && this->is_breakpoint( this->pc_reg ) ) {
+            this->stop = stop_e::breakpoint;
 
-    rd = pc + (this->iword_length >> 3);
-    pc += instr.imm;
+            break;
+        }
+        this->step_instrumented();
+    }
 }
 
 void
-Cpu::_illegal(
-    [[maybe_unused]] instr_t instr
-) const
+Cpu::step_instrumented()
 {
-    throw std::runtime_error( "Illegal opcode." );
+    constexpr addr_t iword_size = iword_length >> 3;
+    const addr_t pc = this->pc_reg;
+
+    // a trapping fetch is not observed
+    if (
+        (pc & (iword_size - 1)) || !this->mem.is_in_bounds( pc, iword_size )
+    ) {
+        this->step_unguarded();
+
+        return;
+    }
+
+    const iword_t iword  = this->fetch();
+    const auto   *cached = this->decode_cache.find( pc );
+    const auto    instr  = cached ? *cached : decoder::decode_compact( iword );
+    // before a load can overwrite `rs1`; meaningless but harmless otherwise
+    const addr_t mem_addr = this->reg_arr[ instr.rs1 ] + instr.imm;
+
+    this->step_unguarded();
+
+    // only retired instructions are observed
+    if ( this->stop == stop_e::trap ) { return; }
+    if ( this->tracer ) {
+        this->tracer->append(
+                { pc, iword, this->reg_arr[ instr.rd ], mem_addr } );
+    }
+    pipeline::observation_t observation;
+    if ( auto *cache_model = this->cache_model.get() ) {
+        auto &level = observation.data_level;
+
+        observation.fetch_level = cache_model->fetch( pc );
+        switch ( instr.mnem ) {
+            case mnem_e::LB:
+            case mnem_e::LBU:  level = cache_model->load( pc, mem_addr, 1 );
+                               break;
+            case mnem_e::LH:
+            case mnem_e::LHU:  level = cache_model->load( pc, mem_addr, 2 );
+                               break;
+            case mnem_e::LW:   level = cache_model->load( pc, mem_addr, 4 );
+                               break;
+            case mnem_e::SB:   level = cache_model->store( pc, mem_addr, 1 );
+                               break;
+            case mnem_e::SH:   level = cache_model->store( pc, mem_addr, 2 );
+                               break;
+            case mnem_e::SW:   level = cache_model->store( pc, mem_addr, 4 );
+                               break;
+
+            default:  break;
+        }
+    }
+    if ( this->branch_model ) {
+        observation.predicted    = true;
+        observation.mispredicted =
+                this->branch_model->observe( pc, instr, this->pc_reg );
+    }
+    if ( this->timing_model ) {
+        this->timing_model->retire( pc, instr, this->pc_reg, observation );
+    }
+}
+
+
+
+
+// INSTRUCTION HANDLER DEFINITIONS
+
+template< mnem_e Mnem >
+void
+Cpu::exec(
+    Cpu &cpu,
+    cinstr_t instr
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+    constexpr auto   opcode     =
+            Mnem != mnem_e::_ILLEGAL ? mnem_opcode( Mnem ) : opcode_e{};
+
+    auto      &pc  = cpu.pc_reg;
+    auto      &rd  = cpu.reg_arr[ instr.rd ];
+    const auto rs1 = cpu.reg_arr[ instr.rs1 ];
+    const auto imm = instr.imm;
+
+    if constexpr ( opcode == opcode_e::arith_r ) {
+        rd = alu< Mnem >( rs1, cpu.reg_arr[ instr.rs2 ] );
+    } else if constexpr ( opcode == opcode_e::arith_i ) {
+        rd = alu< Mnem >( rs1, imm );
+    } else if constexpr ( opcode == opcode_e::load ) {
+        constexpr addr_t size = access_size< Mnem >();
+        const addr_t addr = rs1 + imm;
+
+        // unchecked; past the end of memory, see `recover`
+        word_t value;
+        if constexpr ( size == 1 ) {
+            value = cpu.mem.lb( addr );
+        } else if constexpr ( size == 2 ) {
+            value = cpu.mem.lh( addr );
+        } else {
+            value = cpu.mem.lw( addr );
+        }
+        // nothing of the instruction is written before the access completes
+        std::atomic_signal_fence( std::memory_order_seq_cst );
+        rd = load_extend< Mnem >( value );
+    } else if constexpr ( opcode == opcode_e::store ) {
+        constexpr addr_t size = access_size< Mnem >();
+        const addr_t addr = rs1 + imm;
+        const auto   rs2  = cpu.reg_arr[ instr.rs2 ];
+
+        // unchecked; past the end of memory, see `recover`
+        if constexpr ( size == 1 ) {
+            cpu.mem.sb( addr, static_cast< uint8_t  >( rs2 ) );
+        } else if constexpr ( size == 2 ) {
+            cpu.mem.sh( addr, static_cast< uint16_t >( rs2 ) );
+        } else {
+            cpu.mem.sw( addr, rs2 );
+        }
+        // nothing of the instruction is written before the access completes
+        std::atomic_signal_fence( std::memory_order_seq_cst );
+        cpu.invalidate( addr, size );
+    } else if constexpr ( opcode == opcode_e::branch ) {
+        pc += taken< Mnem >( rs1, cpu.reg_arr[ instr.rs2 ] ) ? imm
+                                                             : iword_size;
+
+        return;
+    } else if constexpr ( opcode == opcode_e::jal ) {
+        rd  = pc + iword_size;
+        pc += imm;
+
+        return;
+    } else if constexpr ( opcode == opcode_e::jalr ) {
+        rd = pc + iword_size;
+        pc = (rs1 + imm) & ~word_mask( 0, 0 );
+
+        return;
+    } else if constexpr ( opcode == opcode_e::auipc ) {
+        rd = pc + imm;
+    } else if constexpr ( opcode == opcode_e::lui ) {
+        rd = imm;
+    } else if constexpr ( opcode == opcode_e::fence ) {
+        // stores already invalidate what they overwrite; `FENCE_I` drops
+        // the invalidated blocks now rather than at the next block entry;
+        // 'FENCE' is a no-op
+        if constexpr ( Mnem == mnem_e::FENCE_I ) {
+            cpu.threaded_engine.drop_invalid();
+            cpu.jit_engine.drop_invalid( cpu );
+        }
+    } else if constexpr ( Mnem == mnem_e::ECALL ) {
+        cpu.ecall();  // updates the pc
+
+        return;
+    } else if constexpr ( Mnem == mnem_e::EBREAK ) {
+        cpu.raise_trap( trap_e::ebreak, 0 );
+
+        return;
+    } else if constexpr ( opcode == opcode_e::system ) {
+        // 'CSRRS' and 'CSRRC' only write if `rs1` (or `uimm`, for the
+        // immediate variants) is not zero
+        constexpr bool always_write =
+                Mnem == mnem_e::CSRRW || Mnem == mnem_e::CSRRWI;
+        cpu.csr( instr, always_write || instr.rs1 );  // updates the pc
+
+        return;
+    } else if constexpr ( Mnem == mnem_e::_ILLEGAL ) {
+        // the instruction word tells more than the opcode kept in `imm`
+        cpu.raise_trap( trap_e::illegal, cpu.fetch() );
+
+        return;
+    }
+
+    pc += iword_size;
 }
 
 }  // END namespace cpu_emu::cpu
@@ -6,14 +6,105 @@
 
 // INCLUDES
 
+#include "branch.hpp"
+#include "cache.hpp"
+#include "checkpoint.hpp"
+#include "console.hpp"
+#include "decode_cache.hpp"
 #include "defines.h"
 #include "isa.hpp"
+#include "jit_engine.hpp"
 #include "memory.hpp"
+#include "pipeline.hpp"
+#include "profiler.hpp"
+#include "threaded_engine.hpp"
+#include "trace.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 
 
 namespace cpu_emu::cpu {
 
+// ENUM CLASS DEFINITIONS
+
+enum class engine_e
+{
+    interp,    // reference interpreter; `Cpu::step`
+    threaded,  // threaded basic blocks; `Threaded_engine`
+    jit,       // native x86-64 basic blocks; `Jit_engine`
+};  // END enum class engine_e
+
+enum class stop_e
+{
+    none,        // still running
+    step_count,  // step budget exhausted
+    breakpoint,  // about to execute an instruction at a breakpoint
+    exit,        // guest invoked `ECALL_EXIT`
+    trap,        // an instruction trapped; see `trap_t`
+};  // END enum class stop_e
+
+enum class trap_e
+{
+    none,
+    fetch_misaligned,  // pc not word-aligned, e.g., after a jump
+    fetch_fault,       // pc past the end of memory
+    illegal,           // illegal instruction or CSR access
+    load_fault,        // load past the end of memory
+    store_fault,       // store past the end of memory
+    ecall,             // environment call not serviced; e.g., input error
+    ebreak,
+};  // END enum class trap_e
+
+
+
+// STRUCT DEFINITIONS
+
+struct stop_conditions_t
+{
+    // Execution stops before an instruction at any of these addresses,
+    // except for the first instruction of a run; this allows resuming.
+    std::vector< isa::addr_t > breakpoint_vec;
+};  // END struct stop_conditions_t
+
+// A trap is precise: the trapping instruction has no effect, and the pc
+// points at it; it is counted as a step, however.
+struct trap_t
+{
+    trap_e      cause;
+    isa::addr_t pc;     // of the trapping instruction or fetch
+    isa::word_t value;  // faulting address, instruction word, or `a7` of
+                        // `ECALL`; 0 for `EBREAK`
+};  // END struct trap_t
+
+struct run_result_t
+{
+    std::size_t step_count;   // steps executed by the run
+    isa::word_t pc;           // pc at which execution stopped
+    stop_e      stop;         // reason for stopping
+    isa::word_t exit_status;  // `a0` of `ECALL_EXIT`; if `stop == exit`
+    trap_t      trap;         // if `stop == trap`
+};  // END struct run_result_t
+
+
+
+// FUNCTION DECLARATIONS
+
+const char *engine_str( engine_e engine );  // e.g., "jit"
+const char *stop_str( stop_e stop );
+const char *trap_str( trap_e trap );
+bool parse_engine( const std::string &str, engine_e &engine );
+
+
+
 // CLASS DEFINITIONS
 
 class Cpu final
@@ -28,8 +119,10 @@ public:
     using word_t    = isa::word_t;
     using addr_t    = isa::addr_t;
     using instr_t   = isa::instr_t;
+    using cinstr_t  = isa::cinstr_t;
     using reg_arr_t = isa::reg_arr_t;
     using reg_idx_t = isa::reg_idx_t;
+    using exec_fn_t = void (*)( Cpu &cpu, cinstr_t instr );  // see `exec`
 
 
 // DATA MEMBERS
@@ -38,14 +131,42 @@ private:
     word_t           &sp_reg       = reg_arr[ isa::reg_idx_ns::sp ];
     word_t            pc_reg       = ENTRY_POINT_ADDR;
     const std::string mem_img_path = MEM_IMG_PATH;
-    memory::Memory    mem          = memory::Memory( mem_img_path );
+    const memory::map_e mem_map    = memory::map_e::shared;
+    memory::Memory    mem          = memory::Memory( mem_img_path, mem_map );
+    Decode_cache      decode_cache;
+    Threaded_engine   threaded_engine;
+    Jit_engine        jit_engine;
+    engine_e          engine       = engine_e::interp;
+    engine_e          ran_engine   = engine_e::interp;  // last; `run_engine`
+    std::size_t       step_count   = 0;  // steps started; incl. trapping
+    stop_e            stop         = stop_e::none;  // set to leave `run`
+    word_t            exit_status  = 0;
+    trap_t            trap         = {};  // if `stop == stop_e::trap`
+    memory::recovery_t recovery;  // armed by `guarded`
+    std::vector< addr_t > breakpoint_vec;  // sorted
+    reg_arr_t         snapshot_reg_arr = {};  // state at the last `snapshot`
+    word_t            snapshot_pc_reg  = 0;
+    console::Console  console;  // standard streams by default; see `ecall`
+    std::unique_ptr< Profiler > profiler;  // set while profiling
+    Profiler::block_t *profiled_block = nullptr;  // in `run_interp_profiled`
+    std::unique_ptr< trace::Writer > tracer;  // set while tracing
+    std::unique_ptr< cache::Hierarchy > cache_model;  // set while modeling
+    std::unique_ptr< branch::Model > branch_model;  // set while modeling
+    std::unique_ptr< pipeline::Model > timing_model;  // set while modeling
+    std::string       checkpoint_path;  // of the last checkpoint or resume
+    std::chrono::steady_clock::time_point start_time =  // for `time`
+            std::chrono::steady_clock::now();
 
 
 // CONSTRUCTOR, DESTRUCTOR DECLARATIONS
 public:
     explicit Cpu( word_t pc_reg = ENTRY_POINT_ADDR,
                   word_t sp_reg = STACK_START_ADDR,
-                  const std::string &mem_img_path = MEM_IMG_PATH );
+                  const std::string &mem_img_path = MEM_IMG_PATH,
+                  memory::map_e mem_map = memory::map_e::shared );
+    explicit Cpu( const memory::Image &image,  // copy-on-write
+                  word_t pc_reg = ENTRY_POINT_ADDR,
+                  word_t sp_reg = STACK_START_ADDR );
     ~Cpu();
 
 
@@ -55,31 +176,87 @@ public:
     const word_t &get_reg( reg_idx_t index ) const;
     const word_t &get_sp_reg() const;
     const word_t &get_pc_reg() const;
+    const engine_e &get_engine() const;
+    const std::size_t &get_step_count() const;
+    const memory::Memory &get_mem() const;
+    const console::Console &get_console() const;
+    const Profiler *get_profiler() const;  // `nullptr` unless profiling
     void set_reg_arr( const reg_arr_t &reg_arr );
     void set_reg( reg_idx_t index, word_t value );
     void set_sp_reg( word_t value );
     void set_pc_reg( word_t value );
+    void set_engine( engine_e engine );
+    void set_console( console::Console &&console );
+    void set_profiling( bool enabled );  // (re)starts with empty counts
+    // While tracing or modeling the caches, branches, or timing, every
+    // retired instruction is observed, and `run` uses the interpreter
+    // whatever the engine.
+    void start_trace( const std::string &file_path );
+    std::size_t stop_trace();  // writes out the trace; returns its length
+    // (re)starts with empty caches and counts
+    void start_cache_model( const cache::hierarchy_config_t &config );
+    const cache::Hierarchy *get_cache_model() const;  // or `nullptr`
+    // (re)starts with an untrained predictor and empty counts
+    void start_branch_model( branch::predictor_e predictor );
+    const branch::Model *get_branch_model() const;  // or `nullptr`
+    // (re)starts at cycle 0; uses the cache and branch models, if started
+    void start_timing_model( const pipeline::timing_config_t &config );
+    const pipeline::Model *get_timing_model() const;  // or `nullptr`
+    // Guest faults never throw; they stop the run with `stop_e::trap`.
     void step();
+    run_result_t run( std::size_t max_steps,
+                      const stop_conditions_t &stop_conditions = {} );
+    void snapshot();
+    void restore();  // to the last `snapshot`; may be repeated
+    // Writes the state to a checkpoint file; only the pages dirtied since
+    // the last checkpoint or resume if it used the same file, else all.
+    // Returns the count of pages written.
+    std::size_t checkpoint( const std::string &file_path );
+    // Continues from the last checkpoint in the file, which must be of the
+    // same memory image; returns the count of checkpoints replayed.
+    std::size_t resume( const std::string &file_path );
 
 
 // PRIVATE MEMBER-FUNCTION DECLARATIONS
 private:
+    // Runs `fn` with `recovery` armed: a guest access past the end of memory,
+    // which the engines leave to `mem`, returns here to `recover`.
+    template< typename T_fn >
+    void guarded( T_fn fn );
+    void recover();  // traps at the access, precisely
+    void step_unguarded();  // `step` within `guarded`
+    void run_engine( std::size_t step_count );  // `run` within `guarded`
     iword_t fetch() const;
     iword_t load_iword( addr_t addr ) const;
-    void execute( instr_t instr );
-    void arith_r( instr_t instr );
-    void load( instr_t instr );
-    void fence( instr_t instr ) const;  // FIX; currently no-op
-    void arith_i( instr_t instr );
-    void jalr( instr_t instr );
-    void system( instr_t instr );
+    void execute( cinstr_t instr );
+    // `exec` of each mnem, indexed by it
+    template< std::size_t... Index >
+    static constexpr std::array< exec_fn_t, isa::mnem_count >
+    make_exec_fn_arr( std::index_sequence< Index... > );
+    // Executes an instruction of `Mnem` and updates the pc, unless it traps.
+    template< isa::mnem_e Mnem >
+    static void exec( Cpu &cpu, cinstr_t instr );
+    void csr( cinstr_t instr, bool write );
+    bool csr_counter( word_t addr, std::uint64_t &value ) const;
     void ecall();
-    void store( instr_t instr );
-    void branch( instr_t instr );
-    void auipc( instr_t instr );
-    void lui( instr_t instr );
-    void jal( instr_t instr );
-    void _illegal( instr_t instr ) const;
+    // false unless nul-terminated within the memory
+    bool guest_str( addr_t addr, std::string_view &str ) const;
+    void raise_trap( trap_e cause, word_t value );  // at the current pc
+    void invalidate( addr_t addr, addr_t size );
+    bool is_breakpoint( addr_t addr ) const;
+    void run_interp( std::size_t step_count );
+    void run_interp_profiled( std::size_t step_count );
+    addr_t block_end( addr_t pc ) const;  // of the interpreter's blocks
+    void step_profiled();  // a single-instruction block
+    bool is_instrumented() const;  // tracing or modeling
+    void run_interp_instrumented( std::size_t step_count );
+    void step_instrumented();
+
+
+// FRIEND DECLARATIONS
+private:
+    friend class Threaded_engine;
+    friend class Jit_engine;
 };  // END class Cpu
 
 }  // END namespace cpu_emu::cpu
@@ -0,0 +1,132 @@
+// decode cache
+
+
+
+// INCLUDES
+
+#include "decode_cache.hpp"
+
+#include "isa.hpp"
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+
+}  // END namespace
+
+
+
+namespace cpu_emu::cpu {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Decode_cache::Decode_cache():
+    entry_vec( entry_count )
+{
+    this->clear();
+}
+
+Decode_cache::~Decode_cache()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+const cinstr_t *
+Decode_cache::find(
+    addr_t pc
+) const
+{
+    const auto &entry = this->entry_vec[ index( pc ) ];
+
+    if ( entry.tag != pc ) { return nullptr; }
+
+    return &entry.instr;
+}
+
+void
+Decode_cache::insert(
+    addr_t pc,
+    const cinstr_t &instr
+)
+{
+    if ( pc & addr_mask( 1, 0 ) ) { return; }  // misaligned; not cached
+
+    auto &entry = this->entry_vec[ index( pc ) ];
+
+    entry.tag   = pc;
+    entry.instr = instr;
+}
+
+void
+Decode_cache::invalidate(
+    addr_t addr,
+    addr_t size
+)
+{
+    if ( !size ) { return; }
+
+    const addr_t first = addr >> 2;  // word indices
+    const addr_t last  = (addr + (size - 1)) >> 2;
+
+    if ( last - first < entry_count ) {
+        // each word maps to exactly one entry
+        for (
+            addr_t word_ = first;
+            word_ - first <= last - first;
+            ++word_
+        ) {
+            auto &entry = this->entry_vec[ index( word_ << 2 ) ];
+
+            if ( entry.tag >> 2 == word_ ) {
+                entry.tag = invalid_tag( index( word_ << 2 ) );
+            }
+        }
+    }
+    else {
+        // range wraps around the cache; check every entry
+        for ( std::size_t i_ = 0;  i_ < entry_count;  ++i_ ) {
+            auto &entry = this->entry_vec[ i_ ];
+
+            if ( (entry.tag >> 2) - first <= last - first ) {
+                entry.tag = invalid_tag( i_ );
+            }
+        }
+    }
+}
+
+void
+Decode_cache::clear()
+{
+    for ( std::size_t i_ = 0;  i_ < entry_count;  ++i_ ) {
+        this->entry_vec[ i_ ].tag = invalid_tag( i_ );
+    }
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+std::size_t
+Decode_cache::index(
+    addr_t addr
+)
+{
+    return (addr >> 2) & (entry_count - 1);
+}
+
+addr_t
+Decode_cache::invalid_tag(
+    std::size_t index
+)
+{
+    // an address mapping to another entry; never matches a lookup here
+    return (index ^ 1) << 2;
+}
+
+}  // END namespace cpu_emu::cpu
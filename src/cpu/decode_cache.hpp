@@ -0,0 +1,69 @@
+#pragma once
+
+// decode cache
+
+
+
+// INCLUDES
+
+#include "defines.h"
+#include "isa.hpp"
+
+#include <cstddef>
+#include <vector>
+
+
+
+namespace cpu_emu::cpu {
+
+// CLASS DEFINITIONS
+
+// A direct-mapped cache of decoded instructions indexed by pc.
+// Only word-aligned pcs are cached; a store to a cached word invalidates it.
+// Entries hold the compact form, `cinstr_t`, so that 12 bytes cover a word.
+class Decode_cache final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    static constexpr auto iword_length = isa::iword_length;
+    static constexpr std::size_t entry_count = DECODE_CACHE_SIZE;
+    using addr_t   = isa::addr_t;
+    using cinstr_t = isa::cinstr_t;
+
+    static_assert( entry_count > 1 && !(entry_count & (entry_count - 1)),
+                   "DECODE_CACHE_SIZE must be a power of two above one." );
+
+private:
+    struct entry_t
+    {
+        addr_t   tag;  // pc of the cached instruction
+        cinstr_t instr;
+    };  // END struct entry_t
+
+
+// DATA MEMBERS
+private:
+    std::vector< entry_t > entry_vec;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Decode_cache();
+    ~Decode_cache();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    const cinstr_t *find( addr_t pc ) const;  // `nullptr` on miss
+    void insert( addr_t pc, const cinstr_t &instr );
+    void invalidate( addr_t addr, addr_t size );
+    void clear();
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    static std::size_t index( addr_t addr );
+    static addr_t invalid_tag( std::size_t index );
+};  // END class Decode_cache
+
+}  // END namespace cpu_emu::cpu
@@ -8,6 +8,8 @@
 
 #include "isa.hpp"
 
+#include <array>
+#include <cstddef>
 #include <stdexcept>
 
 
@@ -24,9 +26,117 @@ using namespace cpu_emu::isa;
 
 namespace cpu_emu::cpu::decoder {
 
+// CONSTEXPR DEFINITIONS
+
+// The `decode_compact` table is keyed on the bits that tell mnems apart:
+// key = instr_word[6:2] | funct3 << 5 | instr_word[30] << 8 | instr_word[20] << 9
+// (bit 30 splits, e.g., 'ADD,SUB'; bit 20 splits 'ECALL,EBREAK').
+// An entry keeps the full `encoding_t` check for the remaining fixed bits.
+struct table_entry_t
+{
+    iword_t       mask;   // see `encoding_t`; never matches if no mnem
+    iword_t       match;
+    mnem_e        mnem;
+    opcode_type_e opcode_type;
+};  // END struct table_entry_t
+
+constexpr unsigned table_key_length = 10;
+constexpr iword_t  table_key_mask   = iword_mask(  6,  2 )
+                                    | iword_mask( 14, 12 )
+                                    | iword_mask( 30, 30 )
+                                    | iword_mask( 20, 20 );
+
+using table_t = std::array< table_entry_t, 1u << table_key_length >;
+
+constexpr
+unsigned
+table_key(
+    iword_t instr_word
+)
+{
+    return iword_extract( instr_word,  6,  2 )
+         | iword_extract( instr_word, 14, 12 ) << 5
+         | iword_extract( instr_word, 30, 30 ) << 8
+         | iword_extract( instr_word, 20, 20 ) << 9;
+}
+
+// Returns a word with the key bits of `key` and all other bits zero.
+constexpr
+iword_t
+table_key_word(
+    unsigned key
+)
+{
+    return (key      & 0x1f) <<  2
+         | (key >> 5 & 0x07) << 12
+         | (key >> 8 & 0x01) << 30
+         | (key >> 9 & 0x01) << 20;
+}
+
+// Returns whether `encoding` may match a word with the key bits of `key`.
+constexpr
+bool
+table_key_matches(
+    unsigned key,
+    const encoding_t &encoding
+)
+{
+    return !((table_key_word( key ) ^ encoding.match)
+             & encoding.mask & table_key_mask);
+}
+
+constexpr
+table_t
+make_table()
+{
+    table_t table{};
+
+    for ( unsigned key_ = 0;  key_ < table.size();  ++key_ ) {
+        table[ key_ ] = { 0, 1, mnem_e::_ILLEGAL, opcode_type_e::_illegal };
+
+        for ( const auto &encoding : encoding_arr ) {
+            if ( !table_key_matches( key_, encoding ) ) { continue; }
+
+            table[ key_ ] = {
+                encoding.mask,
+                encoding.match,
+                encoding.mnem,
+                opcode_type( opcode_e{ encoding.match & iword_mask( 6, 0 ) } )
+            };
+        }
+    }
+
+    return table;
+}
+
+// Returns whether every key selects at most one mnem.
+constexpr
+bool
+table_is_unambiguous()
+{
+    for ( unsigned key_ = 0;  key_ < (1u << table_key_length);  ++key_ ) {
+        unsigned count = 0;
+
+        for ( const auto &encoding : encoding_arr ) {
+            count += table_key_matches( key_, encoding );
+        }
+        if ( count > 1 ) { return false; }
+    }
+
+    return true;
+}
+
+static_assert( table_is_unambiguous(), "Decode-table key is too narrow." );
+
+constexpr table_t decode_table = make_table();
+
+
+
 // FUNCTION DECLARATIONS
 
 instr_t decode( iword_t instr_word );
+cinstr_t compact( const instr_t &instr );
+cinstr_t decode_compact( iword_t instr_word );
 
 static void decode_mnem( instr_t &instr );
 static void decode_mnem_arith_r( instr_t &instr );
@@ -69,6 +179,71 @@ decode(
     return instr;
 }
 
+cinstr_t
+compact(
+    const instr_t &instr
+)
+{
+    cinstr_t cinstr;
+
+    cinstr.imm  = instr.mnem == mnem_e::_ILLEGAL
+                ? static_cast< word_t >( instr.opcode )
+                : instr.imm;
+    cinstr.mnem = instr.mnem;
+    cinstr.rd   = static_cast< uint8_t >( instr.rd );
+    cinstr.rs1  = static_cast< uint8_t >( instr.rs1 );
+    cinstr.rs2  = static_cast< uint8_t >( instr.rs2 );
+
+    return cinstr;
+}
+
+cinstr_t
+decode_compact(
+    iword_t instr_word
+)
+{
+    const auto &entry = decode_table[ table_key( instr_word ) ];
+    const bool  legal = (instr_word & entry.mask) == entry.match;
+
+    const auto  type  = legal ? entry.opcode_type : opcode_type_e::_illegal;
+
+    // each immediate variant masked by whether it is the one; no branches
+    const word_t sign = static_cast< siword_t >( instr_word ) >> 31;
+    const auto   pick = [ type ]( opcode_type_e type_, word_t imm ) -> word_t {
+        return imm & -static_cast< word_t >( type == type_ );
+    };
+
+    cinstr_t cinstr;
+
+    cinstr.imm  = pick( opcode_type_e::imm,
+                        sign << 11
+                      | iword_extract( instr_word, 30, 20 ) )
+                | pick( opcode_type_e::store,
+                        sign << 11
+                      | iword_extract( instr_word, 30, 25 ) << 5
+                      | iword_extract( instr_word, 11,  7 ) )
+                | pick( opcode_type_e::branch,
+                        sign << 12
+                      | iword_extract( instr_word,  7,  7 ) << 11
+                      | iword_extract( instr_word, 30, 25 ) << 5
+                      | iword_extract( instr_word, 11,  8 ) << 1 )
+                | pick( opcode_type_e::upper,
+                        instr_word & iword_mask( 31, 12 ) )
+                | pick( opcode_type_e::jump,
+                        sign << 20
+                      | iword_extract( instr_word, 19, 12 ) << 12
+                      | iword_extract( instr_word, 20, 20 ) << 11
+                      | iword_extract( instr_word, 30, 21 ) << 1 )
+                | pick( opcode_type_e::_illegal,  // see `cinstr_t`
+                        iword_extract( instr_word,  6,  0 ) );
+    cinstr.mnem = legal ? entry.mnem : mnem_e::_ILLEGAL;
+    cinstr.rd   = iword_extract( instr_word, 11,  7 );
+    cinstr.rs1  = iword_extract( instr_word, 19, 15 );
+    cinstr.rs2  = iword_extract( instr_word, 24, 20 );
+
+    return cinstr;
+}
+
 
 
 // STATIC FUNCTION DEFINITIONS
@@ -109,7 +284,8 @@ decode_mnem(
         case opcode_e::jal:      decode_mnem_jal( instr );
             instr.opcode_type = opcode_type_e::jump;    break;
 
-        default:  instr.opcode_type = opcode_type_e::_illegal;  break;
+        default:  instr.mnem = mnem_e::_ILLEGAL;
+            instr.opcode_type = opcode_type_e::_illegal;  break;
     }
 }
 
@@ -363,7 +539,8 @@ decode_imm(
             }  break;
         case opcode_type_e::reg:
         case opcode_type_e::_illegal:
-            break;  // no immediate
+            imm = 0;  // no immediate
+            break;
 
         default:  throw std::logic_error( "Should not occur." );  break;
     }
@@ -15,5 +15,7 @@ namespace cpu_emu::cpu::decoder {
 // FUNCTION DECLARATIONS
 
 isa::instr_t decode( isa::iword_t instr_word );
+isa::cinstr_t compact( const isa::instr_t &instr );
+isa::cinstr_t decode_compact( isa::iword_t instr_word );  // table-driven
 
 }  // END namespace cpu_emu::cpu::decoder
@@ -22,6 +22,38 @@
 #define HEAP_START_ADDR 0x80000  // 512 KiB; must be greater than `_end`
 #endif
 
+#ifndef MEM_PAGE_LENGTH
+#define MEM_PAGE_LENGTH 12  // 4 KiB pages; granularity of dirty tracking
+#endif
+
+#ifndef MEM_GUARD
+#define MEM_GUARD 1  // reserve the 4 GiB address space instead of bounds checks
+#endif
+
+#ifndef DECODE_CACHE_SIZE
+#define DECODE_CACHE_SIZE 0x1000  // 4096 entries; must be a power of two
+#endif
+
+#ifndef BLOCK_MAX_LENGTH
+#define BLOCK_MAX_LENGTH 0x40  // 64 instructions per translated block
+#endif
+
+#ifndef JIT_BUFFER_SIZE
+#define JIT_BUFFER_SIZE 0x1000000  // 16 MiB of generated code
+#endif
+
+#ifndef TRACE_CHUNK_SIZE
+#define TRACE_CHUNK_SIZE 0x4000  // 16384 records (256 KiB) per trace chunk
+#endif
+
+#ifndef TRACE_CHUNK_COUNT
+#define TRACE_CHUNK_COUNT 4  // chunks in the trace ring; the core waits if full
+#endif
+
+#ifndef CONSOLE_BUFFER_SIZE
+#define CONSOLE_BUFFER_SIZE 0x10000  // 64 KiB per console stream
+#endif
+
 #ifndef TEST_INPUT_BUFFER_SIZE
 #define TEST_INPUT_BUFFER_SIZE 0x100  // 256 bytes
 #endif
@@ -0,0 +1,250 @@
+// elf
+
+
+
+// INCLUDES
+
+#include "elf.hpp"
+
+#include "../util/file_utils.hpp"
+#include "isa.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <elf.h>       // Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr, Elf32_Sym
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // pread
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+using namespace cpu_emu::elf;
+
+
+
+// FUNCTION DEFINITIONS
+
+template< typename T >
+T
+read_struct(
+    int fd,
+    std::size_t offset
+)
+{
+    T t;
+    cpu_emu::util::read_fd(
+        fd, reinterpret_cast< std::uint8_t * >( &t ), sizeof( t ), offset );
+
+    return t;
+}
+
+template< typename T >
+std::vector< T >
+read_table(
+    int fd,
+    std::size_t offset,
+    std::size_t count,
+    std::size_t entry_size
+)
+{
+    // an absent table may have no entry size
+    if ( count && entry_size < sizeof( T ) ) {
+        throw std::runtime_error( "Malformed ELF table." );
+    }
+
+    std::vector< T > table;
+    for ( std::size_t i_ = 0;  i_ < count;  ++i_ ) {
+        table.push_back( read_struct< T >( fd, offset + i_ * entry_size ) );
+    }
+
+    return table;
+}
+
+}  // END namespace
+
+
+
+namespace cpu_emu::elf {
+
+// FUNCTION DEFINITIONS
+
+bool
+is_elf(
+    int fd
+)
+{
+    unsigned char magic[ SELFMAG ];
+
+    return pread( fd, magic, SELFMAG, 0 ) == SELFMAG
+        && !std::memcmp( magic, ELFMAG, SELFMAG );
+}
+
+
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Elf::Elf(
+    int fd
+)
+{
+    const auto ehdr = read_struct< Elf32_Ehdr >( fd, 0 );
+    if (
+        std::memcmp( ehdr.e_ident, ELFMAG, SELFMAG )
+     || ehdr.e_ident[ EI_CLASS ] != ELFCLASS32
+     || ehdr.e_ident[ EI_DATA ] != ELFDATA2LSB
+     || ehdr.e_type != ET_EXEC
+     || ehdr.e_machine != EM_RISCV
+    ) {
+        throw std::runtime_error( "Not an RV32 executable." );
+    }
+
+    this->entry = ehdr.e_entry;
+
+    // segments are mapped, and mapped pages past the end of file do not exist
+    struct stat stat_;
+    if ( fstat( fd, &stat_ ) == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    for (
+        const auto &phdr
+      : read_table< Elf32_Phdr >(
+            fd, ehdr.e_phoff, ehdr.e_phnum, ehdr.e_phentsize )
+    ) {
+        if ( phdr.p_type != PT_LOAD || !phdr.p_memsz ) { continue; }
+
+        if (
+            phdr.p_filesz > phdr.p_memsz
+         || std::uint64_t( phdr.p_offset ) + phdr.p_filesz
+          > std::uint64_t( stat_.st_size )
+         || std::uint64_t( phdr.p_vaddr ) + phdr.p_memsz
+          > std::uint64_t( 1 ) << addr_length
+        ) {
+            throw std::runtime_error( "Malformed ELF segment." );
+        }
+
+        this->segment_vec.push_back(
+            { phdr.p_vaddr, phdr.p_filesz, phdr.p_memsz, phdr.p_offset } );
+    }
+
+    // symbols are optional; e.g., the executable may be stripped, or have no
+    // section header table at all, which a zero offset also marks
+    const auto shdr_vec = read_table< Elf32_Shdr >(
+        fd, ehdr.e_shoff, ehdr.e_shoff ? ehdr.e_shnum : 0, ehdr.e_shentsize );
+    for ( const auto &shdr : shdr_vec ) {
+        if ( shdr.sh_type != SHT_SYMTAB || shdr.sh_link >= shdr_vec.size() ) {
+            continue;
+        }
+
+        const auto &str_shdr = shdr_vec[ shdr.sh_link ];
+        std::vector< char > str_vec( str_shdr.sh_size + 1 );  // terminated
+        util::read_fd(
+            fd, reinterpret_cast< std::uint8_t * >( str_vec.data() ),
+            str_shdr.sh_size, str_shdr.sh_offset
+        );
+
+        for (
+            const auto &sym
+          : read_table< Elf32_Sym >(
+                fd, shdr.sh_offset, shdr.sh_size / sizeof( Elf32_Sym ),
+                sizeof( Elf32_Sym ) )
+        ) {
+            const auto type = ELF32_ST_TYPE( sym.st_info );
+            if (
+                sym.st_shndx == SHN_UNDEF
+             || sym.st_name >= str_shdr.sh_size
+             || !str_vec[ sym.st_name ]
+             || (type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE)
+            ) {
+                continue;
+            }
+
+            this->symbol_vec.push_back(
+                { sym.st_value, sym.st_size, &str_vec[ sym.st_name ] } );
+        }
+    }
+
+    std::stable_sort(
+        this->symbol_vec.begin(),
+        this->symbol_vec.end(),
+        []( const symbol_t &lhs, const symbol_t &rhs )
+        {
+            return lhs.addr < rhs.addr;
+        }
+    );
+}
+
+Elf::~Elf()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+addr_t
+Elf::get_entry() const
+{
+    return this->entry;
+}
+
+const std::vector< segment_t > &
+Elf::get_segment_vec() const
+{
+    return this->segment_vec;
+}
+
+const std::vector< symbol_t > &
+Elf::get_symbol_vec() const
+{
+    return this->symbol_vec;
+}
+
+const symbol_t *
+Elf::find_symbol(
+    const std::string &name
+) const
+{
+    for ( const auto &symbol : this->symbol_vec ) {
+        if ( symbol.name == name ) { return &symbol; }
+    }
+
+    return nullptr;
+}
+
+const symbol_t *
+Elf::find_symbol(
+    addr_t addr
+) const
+{
+    // the last symbol starting at or before `addr`
+    auto it = std::upper_bound(
+        this->symbol_vec.begin(),
+        this->symbol_vec.end(),
+        addr,
+        []( addr_t addr_, const symbol_t &symbol )
+        {
+            return addr_ < symbol.addr;
+        }
+    );
+    if ( it == this->symbol_vec.begin() ) { return nullptr; }
+    --it;
+
+    // sizeless symbols, e.g., assembly labels, extend to the next symbol
+    if ( it->size && addr - it->addr >= it->size ) { return nullptr; }
+
+    return &*it;
+}
+
+}  // END namespace cpu_emu::elf
@@ -0,0 +1,76 @@
+#pragma once
+
+// elf
+
+
+
+// INCLUDES
+
+#include "isa.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+
+namespace cpu_emu::elf {
+
+// STRUCT DEFINITIONS
+
+struct segment_t  // loadable segment; `PT_LOAD`
+{
+    isa::addr_t vaddr;
+    isa::addr_t file_size;  // bytes read from the file at `offset`
+    isa::addr_t mem_size;   // `file_size` plus the zero-filled rest; e.g., .bss
+    std::size_t offset;
+};  // END struct segment_t
+
+struct symbol_t
+{
+    isa::addr_t addr;
+    isa::addr_t size;
+    std::string name;
+};  // END struct symbol_t
+
+
+
+// FUNCTION DECLARATIONS
+
+// Returns true if the open file starts with the ELF magic.
+bool
+is_elf(
+    int fd
+);
+
+
+
+// CLASS DEFINITIONS
+
+// The loadable segments, entry point, and symbols of an RV32 executable.
+class Elf final
+{
+// DATA MEMBERS
+private:
+    isa::addr_t              entry;
+    std::vector< segment_t > segment_vec;
+    std::vector< symbol_t >  symbol_vec;  // sorted by address
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    explicit Elf( int fd );  // throws unless the file is an RV32 executable
+    ~Elf();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    isa::addr_t get_entry() const;
+    const std::vector< segment_t > &get_segment_vec() const;
+    const std::vector< symbol_t >  &get_symbol_vec() const;
+    // returns `nullptr` if not found
+    const symbol_t *find_symbol( const std::string &name ) const;
+    const symbol_t *find_symbol( isa::addr_t addr ) const;  // containing `addr`
+};  // END class Elf
+
+}  // END namespace cpu_emu::elf
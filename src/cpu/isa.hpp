@@ -9,7 +9,9 @@
 #include "../util/bit_utils.hpp"
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 
 
 
@@ -80,6 +82,20 @@ namespace reg_idx_ns {
     };  // END enum
 }  // END namespace reg_idx_ns
 
+// CSR addresses; only the unprivileged counters ('Zicntr') are implemented.
+// The 'h' CSRs hold the upper halves of the 64-bit counters.
+namespace csr_ns {
+    enum : word_t
+    {
+        cycle    = 0xc00,  // cycles executed
+        time     = 0xc01,  // wall-clock time
+        instret  = 0xc02,  // instructions retired
+        cycleh   = 0xc80,
+        timeh    = 0xc81,
+        instreth = 0xc82,
+    };  // END enum
+}  // END namespace csr_ns
+
 
 
 // ENUM CLASS DEFINITIONS
@@ -121,7 +137,7 @@ enum class opcode_e : iword_t
 
 // Note that grouped mnems without space in between them share
 // `funct3` but differ in `funct7` or otherwise; e.g., 'ADD,SUB'.
-enum class mnem_e
+enum class mnem_e : uint8_t
 {
 // r-type
     // arith_r
@@ -156,6 +172,9 @@ enum class mnem_e
     _ILLEGAL,
 };  // END enum class mnem_e
 
+constexpr std::size_t mnem_count =  // incl. `_ILLEGAL`
+        static_cast< std::size_t >( mnem_e::_ILLEGAL ) + 1;
+
 
 
 // STRUCT DEFINITIONS
@@ -177,6 +196,282 @@ struct instr_t
     mnem_e mnem;  // mnemonic; 'fully resolved opcode'; e.g., 'XOR'
 };  // END struct instr_t
 
+// A compact form of `instr_t` for execution; the opcode, the format type, and
+// the bit fields other than the register indices are implied by `mnem`.
+// For `_ILLEGAL`, `imm` holds the opcode instead (for diagnostics).
+struct cinstr_t
+{
+    word_t  imm;  // sign-extended; see `instr_t::imm`
+    mnem_e  mnem;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+};  // END struct cinstr_t
+
+static_assert( sizeof( cinstr_t ) == 8, "cinstr_t should stay packed." );
+
+// Fixed bits of each mnem's encoding: `(instr_word & mask) == match`.
+// Note that these mirror `decoder::decode`, which does not check `funct7`
+// where it does not select the mnem (e.g., for 'SLL').
+struct encoding_t
+{
+    mnem_e  mnem;
+    iword_t mask;
+    iword_t match;
+};  // END struct encoding_t
+
+
+
+// CONSTEXPR TABLES
+
+constexpr encoding_t encoding_arr[] =
+{
+// r-type
+    // arith_r
+    { mnem_e::ADD,      0xfe00707f, 0x00000033 },
+    { mnem_e::SUB,      0xfe00707f, 0x40000033 },
+    { mnem_e::SLL,      0x0000707f, 0x00001033 },
+    { mnem_e::SLT,      0x0000707f, 0x00002033 },
+    { mnem_e::SLTU,     0x0000707f, 0x00003033 },
+    { mnem_e::XOR,      0x0000707f, 0x00004033 },
+    { mnem_e::SRL,      0xfe00707f, 0x00005033 },
+    { mnem_e::SRA,      0xfe00707f, 0x40005033 },
+    { mnem_e::OR,       0x0000707f, 0x00006033 },
+    { mnem_e::AND,      0x0000707f, 0x00007033 },
+// i-type
+    // load
+    { mnem_e::LB,       0x0000707f, 0x00000003 },
+    { mnem_e::LH,       0x0000707f, 0x00001003 },
+    { mnem_e::LW,       0x0000707f, 0x00002003 },
+    { mnem_e::LBU,      0x0000707f, 0x00004003 },
+    { mnem_e::LHU,      0x0000707f, 0x00005003 },
+    // fence
+    { mnem_e::FENCE,    0xf00fffff, 0x0000000f },
+    { mnem_e::FENCE_I,  0xffffffff, 0x0000100f },
+    // arith_i
+    { mnem_e::ADDI,     0x0000707f, 0x00000013 },
+    { mnem_e::SLLI,     0x0000707f, 0x00001013 },
+    { mnem_e::SLTI,     0x0000707f, 0x00002013 },
+    { mnem_e::SLTIU,    0x0000707f, 0x00003013 },
+    { mnem_e::XORI,     0x0000707f, 0x00004013 },
+    { mnem_e::SRLI,     0xfe00707f, 0x00005013 },
+    { mnem_e::SRAI,     0xfe00707f, 0x40005013 },
+    { mnem_e::ORI,      0x0000707f, 0x00006013 },
+    { mnem_e::ANDI,     0x0000707f, 0x00007013 },
+    // jalr
+    { mnem_e::JALR,     0x0000707f, 0x00000067 },
+    // system
+    { mnem_e::ECALL,    0xffffffff, 0x00000073 },
+    { mnem_e::EBREAK,   0xffffffff, 0x00100073 },
+    { mnem_e::CSRRW,    0x0000707f, 0x00001073 },
+    { mnem_e::CSRRS,    0x0000707f, 0x00002073 },
+    { mnem_e::CSRRC,    0x0000707f, 0x00003073 },
+    { mnem_e::CSRRWI,   0x0000707f, 0x00005073 },
+    { mnem_e::CSRRSI,   0x0000707f, 0x00006073 },
+    { mnem_e::CSRRCI,   0x0000707f, 0x00007073 },
+// s-type
+    // store
+    { mnem_e::SB,       0x0000707f, 0x00000023 },
+    { mnem_e::SH,       0x0000707f, 0x00001023 },
+    { mnem_e::SW,       0x0000707f, 0x00002023 },
+// b-type
+    // branch
+    { mnem_e::BEQ,      0x0000707f, 0x00000063 },
+    { mnem_e::BNE,      0x0000707f, 0x00001063 },
+    { mnem_e::BLT,      0x0000707f, 0x00004063 },
+    { mnem_e::BGE,      0x0000707f, 0x00005063 },
+    { mnem_e::BLTU,     0x0000707f, 0x00006063 },
+    { mnem_e::BGEU,     0x0000707f, 0x00007063 },
+// u-type
+    // auipc
+    { mnem_e::AUIPC,    0x0000007f, 0x00000017 },
+    // lui
+    { mnem_e::LUI,      0x0000007f, 0x00000037 },
+// j-type
+    // jal
+    { mnem_e::JAL,      0x0000007f, 0x0000006f },
+};  // END encoding_arr
+
+
+
+// CONSTEXPR FUNCTION DEFINITIONS
+
+// Returns the format type of `opcode`.
+constexpr
+opcode_type_e
+opcode_type(
+    opcode_e opcode
+)
+{
+    switch ( opcode ) {
+        case opcode_e::arith_r:  return opcode_type_e::reg;
+        case opcode_e::load:
+        case opcode_e::fence:
+        case opcode_e::arith_i:
+        case opcode_e::jalr:
+        case opcode_e::system:   return opcode_type_e::imm;
+        case opcode_e::store:    return opcode_type_e::store;
+        case opcode_e::branch:   return opcode_type_e::branch;
+        case opcode_e::auipc:
+        case opcode_e::lui:      return opcode_type_e::upper;
+        case opcode_e::jal:      return opcode_type_e::jump;
+
+        default:  return opcode_type_e::_illegal;
+    }
+}
+
+// Returns the assembly name of `mnem`; e.g., "addi".
+constexpr
+const char *
+mnem_str(
+    mnem_e mnem
+)
+{
+    constexpr const char *str_arr[] = {
+        "add", "sub", "sll", "slt", "sltu", "xor", "srl", "sra", "or", "and",
+        "lb", "lh", "lw", "lbu", "lhu",
+        "fence", "fence.i",
+        "addi", "slli", "slti", "sltiu", "xori", "srli", "srai", "ori", "andi",
+        "jalr",
+        "ecall", "ebreak",
+        "csrrw", "csrrs", "csrrc", "csrrwi", "csrrsi", "csrrci",
+        "sb", "sh", "sw",
+        "beq", "bne", "blt", "bge", "bltu", "bgeu",
+        "auipc",
+        "lui",
+        "jal",
+        "(illegal)",
+    };
+    static_assert(
+        std::size( str_arr ) == mnem_count,
+        "Every mnem should have a name."
+    );
+
+    return str_arr[ static_cast< std::size_t >( mnem ) ];
+}
+
+// Returns the opcode of `mnem`, which must not be `_ILLEGAL`.
+constexpr
+opcode_e
+mnem_opcode(
+    mnem_e mnem
+)
+{
+    for ( const auto &encoding : encoding_arr ) {
+        if ( encoding.mnem == mnem ) {
+            return opcode_e{ encoding.match & iword_mask( 6, 0 ) };
+        }
+    }
+
+    return opcode_e{};
+}
+
+// The semantics below are resolved per mnem at compile time; they are shared
+// by the interpreter and the block engines.
+
+// Returns the result of an 'arith_r' or 'arith_i' mnem; `rhs` is `rs2` or the
+// immediate, of which shifts use the low 5 bits.
+template< mnem_e Mnem >
+constexpr
+word_t
+alu(
+    word_t lhs,
+    word_t rhs
+)
+{
+    if constexpr ( Mnem == mnem_e::ADD || Mnem == mnem_e::ADDI ) {
+        return lhs + rhs;
+    } else if constexpr ( Mnem == mnem_e::SUB ) {
+        return lhs - rhs;
+    } else if constexpr ( Mnem == mnem_e::SLL || Mnem == mnem_e::SLLI ) {
+        return lhs << word_extract( rhs, 4, 0 );
+    } else if constexpr ( Mnem == mnem_e::SLT || Mnem == mnem_e::SLTI ) {
+        return static_cast< sword_t >( lhs ) < static_cast< sword_t >( rhs );
+    } else if constexpr ( Mnem == mnem_e::SLTU || Mnem == mnem_e::SLTIU ) {
+        return lhs < rhs;
+    } else if constexpr ( Mnem == mnem_e::XOR || Mnem == mnem_e::XORI ) {
+        return lhs ^ rhs;
+    } else if constexpr ( Mnem == mnem_e::SRL || Mnem == mnem_e::SRLI ) {
+        return lhs >> word_extract( rhs, 4, 0 );
+    } else if constexpr ( Mnem == mnem_e::SRA || Mnem == mnem_e::SRAI ) {
+        return static_cast< sword_t >( lhs ) >> word_extract( rhs, 4, 0 );
+    } else if constexpr ( Mnem == mnem_e::OR || Mnem == mnem_e::ORI ) {
+        return lhs | rhs;
+    } else {
+        static_assert( Mnem == mnem_e::AND || Mnem == mnem_e::ANDI,
+                       "Not an 'arith_r' or 'arith_i' mnem." );
+        return lhs & rhs;
+    }
+}
+
+// Returns whether a 'branch' mnem is taken.
+template< mnem_e Mnem >
+constexpr
+bool
+taken(
+    word_t lhs,
+    word_t rhs
+)
+{
+    if constexpr ( Mnem == mnem_e::BEQ ) {
+        return lhs == rhs;
+    } else if constexpr ( Mnem == mnem_e::BNE ) {
+        return lhs != rhs;
+    } else if constexpr ( Mnem == mnem_e::BLT ) {
+        return static_cast< sword_t >( lhs ) <  static_cast< sword_t >( rhs );
+    } else if constexpr ( Mnem == mnem_e::BGE ) {
+        return static_cast< sword_t >( lhs ) >= static_cast< sword_t >( rhs );
+    } else if constexpr ( Mnem == mnem_e::BLTU ) {
+        return lhs <  rhs;
+    } else {
+        static_assert( Mnem == mnem_e::BGEU, "Not a 'branch' mnem." );
+        return lhs >= rhs;
+    }
+}
+
+// Returns the byte count accessed by a 'load' or 'store' mnem.
+template< mnem_e Mnem >
+constexpr
+addr_t
+access_size()
+{
+    if constexpr (
+        Mnem == mnem_e::LB || Mnem == mnem_e::LBU || Mnem == mnem_e::SB
+    ) {
+        return 1;
+    } else if constexpr (
+        Mnem == mnem_e::LH || Mnem == mnem_e::LHU || Mnem == mnem_e::SH
+    ) {
+        return 2;
+    } else {
+        static_assert( Mnem == mnem_e::LW || Mnem == mnem_e::SW,
+                       "Not a 'load' or 'store' mnem." );
+        return 4;
+    }
+}
+
+// Returns the register value of a 'load' mnem from the loaded `value`,
+// sign-extended for 'LB' and 'LH'.
+template< mnem_e Mnem >
+constexpr
+word_t
+load_extend(
+    word_t value
+)
+{
+    // static casts needed for automatic sign-extension
+    if constexpr ( Mnem == mnem_e::LB ) {
+        return static_cast< int8_t  >( value );
+    } else if constexpr ( Mnem == mnem_e::LH ) {
+        return static_cast< int16_t >( value );
+    } else {
+        static_assert(
+            Mnem == mnem_e::LW || Mnem == mnem_e::LBU || Mnem == mnem_e::LHU,
+            "Not a 'load' mnem." );
+        return value;
+    }
+}
+
 }  // END inline namespace rv32i
 
 }  // END namespace cpu_emu::isa
@@ -0,0 +1,814 @@
+// jit engine
+
+
+
+// INCLUDES
+
+#include "jit_engine.hpp"
+
+#include "cpu.hpp"
+#include "decoder.hpp"
+#include "isa.hpp"
+#include "x86_emitter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <sys/mman.h>  // mmap, munmap
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+
+}  // END namespace
+
+
+
+namespace cpu_emu::cpu {
+
+// TYPE ALIASES
+
+using block_t   = Jit_engine::block_t;
+using context_t = Jit_engine::context_t;
+using exit_t    = Jit_engine::exit_t;
+using reg_e     = X86_emitter::reg_e;
+using alu_e     = X86_emitter::alu_e;
+using shift_e   = X86_emitter::shift_e;
+using cond_e    = X86_emitter::cond_e;
+using width_e   = X86_emitter::width_e;
+
+
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Jit_engine::Jit_engine()
+{}
+
+Jit_engine::~Jit_engine()
+{
+    if ( this->code_carr ) { munmap( this->code_carr, code_buffer_size ); }
+}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+void
+Jit_engine::run(
+    Cpu &cpu,
+    std::size_t step_count
+)
+{
+    if ( !this->code_carr && !this->code_failed ) {
+        this->code_failed = !this->map_code_buffer();
+    }
+    this->code_map.resize( cpu.mem.get_mem_size() );
+    this->context.reg_carr = cpu.reg_arr.data();
+    this->context.mem_carr = cpu.mem.get_mem_carr_nc();
+    this->context.dirty_carr = cpu.mem.get_dirty_carr_nc();
+    this->context.code_page_carr = this->code_map.get_page_carr();
+
+    Profiler *const profiler = cpu.profiler.get();  // or `nullptr`
+
+    for (
+        bool first_ = true;
+        step_count && cpu.stop == stop_e::none;
+        first_ = false
+    ) {
+        if ( !this->invalid_vec.empty() ) { this->drop_invalid( cpu ); }
+
+        const addr_t pc = cpu.pc_reg;
+        auto &block = this->find_block( cpu, pc );
+
+        // blocks end at breakpoints, so checking block entries suffices
+        if ( block.breakpoint && !first_ ) {
+            cpu.stop = stop_e::breakpoint;
+
+            break;
+        }
+
+        // untranslatable instruction or too few steps left; interpret
+        if ( !block.length || block.length > step_count ) {
+            if ( profiler ) { cpu.step_profiled(); }
+            else            { cpu.step_unguarded(); }
+            --step_count;
+
+            continue;
+        }
+
+        if ( profiler ) {
+            if ( !block.profile ) {
+                block.profile = &profiler->get_block( pc, block.end_pc );
+            }
+            ++block.profile->count;
+        }
+
+        // chained blocks run on while the budget lasts
+        const std::size_t budget = std::min< std::size_t >(
+                step_count, UINT32_MAX );
+        this->context.budget = budget;
+        const bool interpret_next = block.fn( &this->context );
+        const std::size_t retired = budget - this->context.budget;
+
+        cpu.pc_reg = this->context.pc;
+        cpu.step_count += retired;
+        step_count -= retired;
+
+        // not chained while profiling; a single block ran, perhaps left
+        // before a memory fault or a store to a code page
+        if ( profiler ) {
+            if ( retired != block.length ) {
+                profiler->truncate( *block.profile,
+                                    pc + retired * (iword_length >> 3) );
+            }
+            else if ( cpu.pc_reg != block.end_pc ) {
+                ++block.profile->jump_count;
+            }
+        }
+
+        // memory fault or store to a code page; interpret it
+        if ( interpret_next && step_count ) {
+            if ( profiler ) { cpu.step_profiled(); }
+            else            { cpu.step_unguarded(); }
+            --step_count;
+        }
+    }
+}
+
+void
+Jit_engine::invalidate(
+    addr_t addr,
+    addr_t size
+)
+{
+    // dropped before the next block is entered
+    if ( this->code_map.is_code( addr, size ) ) {
+        this->code_map.find( addr, size, this->invalid_vec );
+    }
+}
+
+void
+Jit_engine::drop_invalid(
+    Cpu &cpu
+)
+{
+    for ( const auto pc : this->invalid_vec ) { this->drop_block( cpu, pc ); }
+    this->invalid_vec.clear();
+}
+
+void
+Jit_engine::clear()
+{
+    this->block_map.clear();
+    this->source_map.clear();
+    this->code_map.clear();
+    this->invalid_vec.clear();
+    this->code_size = 0;
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+bool
+Jit_engine::map_code_buffer()
+{
+#if defined( __x86_64__ )
+    auto start_addr = mmap(
+        nullptr,  // addr
+        code_buffer_size,  // length
+        PROT_READ | PROT_WRITE | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,  // fd
+        0  // offset
+    );
+    if ( start_addr == MAP_FAILED ) { return false; }
+
+    this->code_carr = static_cast< uint8_t * >( start_addr );
+
+    return true;
+#else
+    return false;  // no code generator for this host
+#endif
+}
+
+block_t &
+Jit_engine::find_block(
+    Cpu &cpu,
+    addr_t pc
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    auto it = this->block_map.find( pc );
+    if ( it != this->block_map.end() ) { return it->second; }
+
+    auto &block = this->block_map.emplace( pc, this->translate( cpu, pc ) )
+            .first->second;
+    for ( const auto &exit : block.exit_vec ) {
+        this->source_map[ exit.target ].push_back( pc );
+    }
+    // an untranslated block still covers its first instruction
+    this->code_map.add( { pc, std::max( block.end_pc, pc + iword_size ) } );
+
+    // chain to the targets translated, and from the sources; profiling
+    // counts each block entry, so it needs every block to return
+    if ( !cpu.profiler ) {
+        for ( const auto &exit : block.exit_vec ) {
+            const auto target_it = this->block_map.find( exit.target );
+            if ( target_it != this->block_map.end() ) {
+                this->link( exit, &target_it->second );
+            }
+        }
+        if ( const auto source_it = this->source_map.find( pc );
+             source_it != this->source_map.end() ) {
+            for ( const auto source_pc : source_it->second ) {
+                const auto &source = this->block_map.at( source_pc );
+                for ( const auto &exit : source.exit_vec ) {
+                    if ( exit.target == pc ) { this->link( exit, &block ); }
+                }
+            }
+        }
+    }
+
+    return block;
+}
+
+void
+Jit_engine::drop_block(
+    Cpu &cpu,
+    addr_t pc
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    const auto it = this->block_map.find( pc );
+    if ( it == this->block_map.end() ) { return; }  // already dropped
+    const auto &block = it->second;
+
+    // unlink the sources; they may link again once retranslated
+    if ( const auto source_it = this->source_map.find( pc );
+         source_it != this->source_map.end() ) {
+        for ( const auto source_pc : source_it->second ) {
+            const auto &source = this->block_map.at( source_pc );
+            for ( const auto &exit : source.exit_vec ) {
+                if ( exit.target == pc ) { this->link( exit, nullptr ); }
+            }
+        }
+    }
+    for ( const auto &exit : block.exit_vec ) {
+        auto &source_vec = this->source_map[ exit.target ];
+        source_vec.erase(
+                std::remove( source_vec.begin(), source_vec.end(), pc ),
+                source_vec.end() );
+    }
+
+    // the code stays in the buffer, unreachable, until it is cleared; the
+    // pages may no longer be flagged, so the stores translated from now on
+    // would leave what the interpreter decoded of the block stale
+    const addr_t end_pc = std::max( block.end_pc, pc + iword_size );
+    this->code_map.remove( { pc, end_pc } );
+    cpu.decode_cache.invalidate( pc, end_pc - pc );
+    this->block_map.erase( it );
+}
+
+void
+Jit_engine::link(
+    const exit_t &exit,
+    const block_t *target
+)
+{
+    // blocks at breakpoints are entered from `run`, which stops there
+    const bool chain = target && target->fn && !target->breakpoint;
+    const std::size_t dest = chain ? target->code_offset : exit.patch_offset;
+    const isa::uint32_t rel = dest - exit.patch_offset;
+
+    std::memcpy( this->code_carr + exit.patch_offset - 4, &rel, 4 );
+}
+
+block_t
+Jit_engine::translate(
+    Cpu &cpu,
+    addr_t pc
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+    const addr_t mem_size = cpu.mem.get_mem_size();
+
+    std::vector< instr_t > instr_vec;
+    addr_t end_pc = pc;
+
+    // misaligned pcs are left to the interpreter, which traps
+    while (
+        instr_vec.size() < block_max_length
+        && !(pc & (iword_size - 1))
+        && mem_size >= iword_size
+        && end_pc <= mem_size - iword_size
+        && (end_pc == pc || !cpu.is_breakpoint( end_pc ))
+    ) {
+        const auto instr = decoder::decode( cpu.load_iword( end_pc ) );
+
+        if ( !translatable( instr ) ) { break; }  // left to the interpreter
+
+        instr_vec.push_back( instr );
+        end_pc += iword_size;
+
+        if ( ends_block( instr ) ) { break; }
+    }
+
+    const bool breakpoint = cpu.is_breakpoint( pc );
+    if ( instr_vec.empty() || !this->code_carr ) {
+        return { nullptr, 0, pc, 0, breakpoint, nullptr, {} };
+    }
+
+    std::vector< exit_t > exit_vec;
+    auto size = emit_block(
+        instr_vec, pc, mem_size,
+        this->code_carr + this->code_size,
+        this->code_carr + code_buffer_size,
+        exit_vec
+    );
+    if ( !size ) {
+        // code buffer full; start over, with the decodes of the dropped
+        // blocks, as in `drop_block`
+        this->clear();
+        cpu.decode_cache.clear();
+        exit_vec.clear();
+        size = emit_block(
+            instr_vec, pc, mem_size,
+            this->code_carr,
+            this->code_carr + code_buffer_size,
+            exit_vec
+        );
+        if ( !size ) {
+            return { nullptr, 0, pc, 0, breakpoint, nullptr, {} };
+        }
+    }
+
+    const std::size_t code_offset = this->code_size;
+    for ( auto &exit : exit_vec ) { exit.patch_offset += code_offset; }
+
+    block_fn_t fn;
+    const uint8_t *code_ptr = this->code_carr + code_offset;
+    std::memcpy( &fn, &code_ptr, sizeof( fn ) );
+
+    this->code_size += (size + 15) & ~std::size_t( 15 );  // align blocks
+    this->code_size  = std::min( this->code_size, code_buffer_size );
+
+    return {
+        fn, code_offset, end_pc, instr_vec.size(), breakpoint, nullptr,
+        std::move( exit_vec )
+    };
+}
+
+bool
+Jit_engine::translatable(
+    const instr_t &instr
+)
+{
+    switch ( instr.mnem ) {
+        case mnem_e::ECALL:
+        case mnem_e::EBREAK:  // traps
+        case mnem_e::FENCE_I:
+        case mnem_e::CSRRW:  // the counters need the exact step count
+        case mnem_e::CSRRS:
+        case mnem_e::CSRRC:
+        case mnem_e::CSRRWI:
+        case mnem_e::CSRRSI:
+        case mnem_e::CSRRCI:
+        case mnem_e::_ILLEGAL:
+            return false;
+
+        default:  return true;
+    }
+}
+
+bool
+Jit_engine::ends_block(
+    const instr_t &instr
+)
+{
+    switch ( instr.opcode ) {
+        case opcode_e::jal:
+        case opcode_e::jalr:
+        case opcode_e::branch:
+            return true;
+
+        default:  return false;
+    }
+}
+
+std::size_t
+Jit_engine::emit_block(
+    const std::vector< instr_t > &instr_vec,
+    addr_t pc,
+    addr_t mem_size,
+    uint8_t *begin_ptr,
+    uint8_t *end_ptr,
+    std::vector< exit_t > &exit_vec
+)
+{
+    // host register roles:
+    // rdi: context; rbx: guest registers; rbp: guest memory;
+    // rax, rcx, rdx: scratch; the rest: allocated to guest registers
+    constexpr std::array< reg_e, 9 > host_pool = {
+        reg_e::rsi, reg_e::r8,  reg_e::r9,  reg_e::r10, reg_e::r11,
+        reg_e::r12, reg_e::r13, reg_e::r14, reg_e::r15,
+    };
+    constexpr reg_e no_host = reg_e::rsp;  // never allocated
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    constexpr int8_t reg_carr_disp = offsetof( context_t, reg_carr );
+    constexpr int8_t mem_carr_disp = offsetof( context_t, mem_carr );
+    constexpr int8_t pc_disp       = offsetof( context_t, pc );
+    constexpr int8_t budget_disp   = offsetof( context_t, budget );
+    constexpr int8_t dirty_disp    = offsetof( context_t, dirty_carr );
+    constexpr int8_t code_page_disp = offsetof( context_t, code_page_carr );
+
+    X86_emitter x( begin_ptr, end_ptr );
+
+    // register allocation; the most used guest registers get host registers
+    std::array< unsigned, reg_count > use_count = {};
+    std::array< bool,     reg_count > written   = {};
+    for ( const auto &instr : instr_vec ) {
+        switch ( instr.opcode ) {
+            case opcode_e::arith_r:
+                ++use_count[ instr.rs2 ];
+                [[fallthrough]];
+            case opcode_e::load:
+            case opcode_e::arith_i:
+            case opcode_e::jalr:
+                ++use_count[ instr.rs1 ];
+                [[fallthrough]];
+            case opcode_e::auipc:
+            case opcode_e::lui:
+            case opcode_e::jal:
+                ++use_count[ instr.rd ];
+                written[ instr.rd ] = true;
+                break;
+            case opcode_e::store:
+            case opcode_e::branch:
+                ++use_count[ instr.rs1 ];
+                ++use_count[ instr.rs2 ];
+                break;
+
+            default:  break;  // no register operands used
+        }
+    }
+    std::array< reg_idx_t, reg_count - 1 > order;
+    for ( reg_idx_t i_ = 1;  i_ < reg_count;  ++i_ ) { order[ i_ - 1 ] = i_; }
+    std::stable_sort( order.begin(), order.end(),
+            [ &use_count ]( auto lhs, auto rhs )
+            { return use_count[ lhs ] > use_count[ rhs ]; } );
+
+    std::array< reg_e, reg_count > host_of;
+    host_of.fill( no_host );
+    std::size_t host_count = 0;
+    for ( auto reg_idx : order ) {
+        // a register used only once is not worth a load and a store
+        if ( host_count == host_pool.size() || use_count[ reg_idx ] < 2 ) {
+            break;
+        }
+        host_of[ reg_idx ] = host_pool[ host_count++ ];
+    }
+
+    // guest register access
+    const auto disp = []( reg_idx_t reg_idx ) -> int8_t
+    {
+        return reg_idx * (word_length >> 3);
+    };
+    const auto get = [ & ]( reg_e dst, reg_idx_t reg_idx )
+    {
+        if ( !reg_idx ) {
+            x.alu_rr( alu_e::xor_, dst, dst );
+        } else if ( host_of[ reg_idx ] != no_host ) {
+            x.mov_rr( dst, host_of[ reg_idx ] );
+        } else {
+            x.mov_rm( dst, reg_e::rbx, disp( reg_idx ) );
+        }
+    };
+    const auto put = [ & ]( reg_idx_t reg_idx, reg_e src )
+    {
+        if ( !reg_idx ) {
+            return;  // reg_0 has a fixed value
+        } else if ( host_of[ reg_idx ] != no_host ) {
+            x.mov_rr( host_of[ reg_idx ], src );
+        } else {
+            x.mov_mr( reg_e::rbx, disp( reg_idx ), src );
+        }
+    };
+
+    // prologue, epilogue
+    const auto saved = [ & ]( reg_e reg )
+    {
+        if ( reg == reg_e::rbx || reg == reg_e::rbp ) { return true; }
+        for ( std::size_t i_ = 5;  i_ < host_count;  ++i_ ) {
+            if ( host_pool[ i_ ] == reg ) { return true; }  // r12..r15
+        }
+
+        return false;
+    };
+    constexpr std::array< reg_e, 6 > callee_saved = {
+        reg_e::rbx, reg_e::rbp, reg_e::r12, reg_e::r13, reg_e::r14, reg_e::r15,
+    };
+    // entered only if the whole block fits the budget
+    x.alu_mi( alu_e::cmp, reg_e::rdi, budget_disp, instr_vec.size() );
+    const auto over_budget = x.jcc( cond_e::b );
+    for ( auto reg : callee_saved ) {
+        if ( saved( reg ) ) { x.push( reg ); }
+    }
+    x.mov64_rm( reg_e::rbx, reg_e::rdi, reg_carr_disp );
+    x.mov64_rm( reg_e::rbp, reg_e::rdi, mem_carr_disp );
+    for ( reg_idx_t i_ = 1;  i_ < reg_count;  ++i_ ) {
+        if ( host_of[ i_ ] != no_host ) {
+            x.mov_rm( host_of[ i_ ], reg_e::rbx, disp( i_ ) );
+        }
+    }
+
+    const auto set_pc = [ & ]( addr_t target )
+    {
+        x.mov_mi( reg_e::rdi, pc_disp, target );
+    };
+    const auto leave = [ & ]( std::size_t retired, bool interpret_next )
+    {
+        for ( reg_idx_t i_ = 1;  i_ < reg_count;  ++i_ ) {
+            if ( host_of[ i_ ] != no_host && written[ i_ ] ) {
+                x.mov_mr( reg_e::rbx, disp( i_ ), host_of[ i_ ] );
+            }
+        }
+        if ( retired ) {
+            x.alu_mi( alu_e::sub, reg_e::rdi, budget_disp, retired );
+        }
+        x.mov_ri( reg_e::rax, interpret_next );
+        for (
+            auto it_ = callee_saved.rbegin();
+            it_ != callee_saved.rend();
+            ++it_
+        ) {
+            if ( saved( *it_ ) ) { x.pop( *it_ ); }
+        }
+    };
+    const auto exit = [ & ]( std::size_t retired, bool interpret_next )
+    {
+        leave( retired, interpret_next );
+        x.ret();
+    };
+    // to a direct target; the `jmp` is patched to chain, and returns as is
+    const auto chain_exit = [ & ]( std::size_t retired, addr_t target )
+    {
+        set_pc( target );
+        leave( retired, false );
+        const auto label = x.jmp();
+        x.bind( label );
+        x.ret();
+        exit_vec.push_back( { target, label } );
+    };
+
+    // out-of-line exits to the interpreter
+    struct stub_t
+    {
+        std::size_t label;
+        addr_t      pc;
+        std::size_t retired;
+    };
+    std::vector< stub_t > stub_vec;
+
+    // bounds check as in `Memory`; `addr` in eax
+    const auto check_bounds = [ & ]( addr_t size, addr_t instr_pc,
+                                     std::size_t retired )
+    {
+        x.alu_ri( alu_e::cmp, reg_e::rax, mem_size - (size - 1) );
+        stub_vec.push_back( { x.jcc( cond_e::ae ), instr_pc, retired } );
+    };
+
+    for ( std::size_t i_ = 0;  i_ < instr_vec.size();  ++i_ ) {
+        const auto &instr = instr_vec[ i_ ];
+        const addr_t instr_pc = pc + i_ * iword_size;
+        const addr_t next_pc  = instr_pc + iword_size;
+        const auto rd = instr.rd;
+
+        switch ( instr.opcode ) {
+            case opcode_e::arith_r: {
+                if ( !rd ) { break; }  // no side effects
+
+                get( reg_e::rax, instr.rs1 );
+                get( reg_e::rcx, instr.rs2 );
+                switch ( instr.mnem ) {
+                    case mnem_e::ADD:
+                        x.alu_rr( alu_e::add, reg_e::rax, reg_e::rcx );  break;
+                    case mnem_e::SUB:
+                        x.alu_rr( alu_e::sub, reg_e::rax, reg_e::rcx );  break;
+                    case mnem_e::SLL:
+                        x.shift_rcl( shift_e::shl, reg_e::rax );  break;
+                    case mnem_e::SLT:
+                        x.alu_rr( alu_e::cmp, reg_e::rax, reg_e::rcx );
+                        x.setcc_movzx( cond_e::l, reg_e::rax );  break;
+                    case mnem_e::SLTU:
+                        x.alu_rr( alu_e::cmp, reg_e::rax, reg_e::rcx );
+                        x.setcc_movzx( cond_e::b, reg_e::rax );  break;
+                    case mnem_e::XOR:
+                        x.alu_rr( alu_e::xor_, reg_e::rax, reg_e::rcx );  break;
+                    case mnem_e::SRL:
+                        x.shift_rcl( shift_e::shr, reg_e::rax );  break;
+                    case mnem_e::SRA:
+                        x.shift_rcl( shift_e::sar, reg_e::rax );  break;
+                    case mnem_e::OR:
+                        x.alu_rr( alu_e::or_, reg_e::rax, reg_e::rcx );  break;
+                    case mnem_e::AND:
+                        x.alu_rr( alu_e::and_, reg_e::rax, reg_e::rcx );  break;
+
+                    default:  break;
+                }
+                put( rd, reg_e::rax );
+
+                break;
+            }
+            case opcode_e::arith_i: {
+                if ( !rd ) { break; }  // no side effects
+
+                const auto imm   = instr.imm;
+                const auto shamt = word_extract( imm, 4, 0 );
+
+                get( reg_e::rax, instr.rs1 );
+                switch ( instr.mnem ) {
+                    case mnem_e::ADDI:
+                        x.alu_ri( alu_e::add, reg_e::rax, imm );  break;
+                    case mnem_e::SLLI:
+                        x.shift_ri( shift_e::shl, reg_e::rax, shamt );  break;
+                    case mnem_e::SLTI:
+                        x.alu_ri( alu_e::cmp, reg_e::rax, imm );
+                        x.setcc_movzx( cond_e::l, reg_e::rax );  break;
+                    case mnem_e::SLTIU:
+                        x.alu_ri( alu_e::cmp, reg_e::rax, imm );
+                        x.setcc_movzx( cond_e::b, reg_e::rax );  break;
+                    case mnem_e::XORI:
+                        x.alu_ri( alu_e::xor_, reg_e::rax, imm );  break;
+                    case mnem_e::SRLI:
+                        x.shift_ri( shift_e::shr, reg_e::rax, shamt );  break;
+                    case mnem_e::SRAI:
+                        x.shift_ri( shift_e::sar, reg_e::rax, shamt );  break;
+                    case mnem_e::ORI:
+                        x.alu_ri( alu_e::or_, reg_e::rax, imm );  break;
+                    case mnem_e::ANDI:
+                        x.alu_ri( alu_e::and_, reg_e::rax, imm );  break;
+
+                    default:  break;
+                }
+                put( rd, reg_e::rax );
+
+                break;
+            }
+            case opcode_e::load: {
+                width_e width = width_e::word;
+                bool    sign  = false;
+                addr_t  size  = 4;
+                switch ( instr.mnem ) {
+                    case mnem_e::LB:   width = width_e::byte;  sign = true;
+                                       size = 1;  break;
+                    case mnem_e::LH:   width = width_e::half;  sign = true;
+                                       size = 2;  break;
+                    case mnem_e::LBU:  width = width_e::byte;  size = 1;  break;
+                    case mnem_e::LHU:  width = width_e::half;  size = 2;  break;
+
+                    default:  break;
+                }
+
+                get( reg_e::rax, instr.rs1 );
+                x.alu_ri( alu_e::add, reg_e::rax, instr.imm );
+                check_bounds( size, instr_pc, i_ );
+                x.load( width, sign, reg_e::rax, reg_e::rbp, reg_e::rax );
+                put( rd, reg_e::rax );
+
+                break;
+            }
+            case opcode_e::store: {
+                width_e width = width_e::word;
+                addr_t  size  = 4;
+                switch ( instr.mnem ) {
+                    case mnem_e::SB:  width = width_e::byte;  size = 1;  break;
+                    case mnem_e::SH:  width = width_e::half;  size = 2;  break;
+
+                    default:  break;
+                }
+
+                get( reg_e::rax, instr.rs1 );
+                x.alu_ri( alu_e::add, reg_e::rax, instr.imm );
+                check_bounds( size, instr_pc, i_ );
+                // stores to pages of translated code are left to the
+                // interpreter, which invalidates the overlapped blocks
+                x.mov64_rm( reg_e::rdx, reg_e::rdi, code_page_disp );
+                for ( const addr_t offset : { addr_t( 0 ), size - 1 } ) {
+                    if ( offset && size == 1 ) { break; }
+                    x.mov_rr( reg_e::rcx, reg_e::rax );
+                    if ( offset ) {
+                        x.alu_ri( alu_e::add, reg_e::rcx, offset );
+                    }
+                    x.shift_ri( shift_e::shr, reg_e::rcx, page_length );
+                    x.load( width_e::byte, false,
+                            reg_e::rcx, reg_e::rdx, reg_e::rcx );
+                    x.alu_rr( alu_e::or_, reg_e::rcx, reg_e::rcx );
+                    stub_vec.push_back( { x.jcc( cond_e::ne ), instr_pc, i_ } );
+                }
+                // mark the first and the last byte's pages dirty
+                x.mov64_rm( reg_e::rdx, reg_e::rdi, dirty_disp );
+                x.mov_rr( reg_e::rcx, reg_e::rax );
+                x.shift_ri( shift_e::shr, reg_e::rcx, page_length );
+                x.store_i8( reg_e::rdx, reg_e::rcx, 1 );
+                if ( size > 1 ) {
+                    x.mov_rr( reg_e::rcx, reg_e::rax );
+                    x.alu_ri( alu_e::add, reg_e::rcx, size - 1 );
+                    x.shift_ri( shift_e::shr, reg_e::rcx, page_length );
+                    x.store_i8( reg_e::rdx, reg_e::rcx, 1 );
+                }
+                get( reg_e::rcx, instr.rs2 );
+                x.store( width, reg_e::rbp, reg_e::rax, reg_e::rcx );
+
+                break;
+            }
+            case opcode_e::branch: {
+                cond_e cond = cond_e::e;
+                switch ( instr.mnem ) {
+                    case mnem_e::BEQ:   cond = cond_e::e;   break;
+                    case mnem_e::BNE:   cond = cond_e::ne;  break;
+                    case mnem_e::BLT:   cond = cond_e::l;   break;
+                    case mnem_e::BGE:   cond = cond_e::ge;  break;
+                    case mnem_e::BLTU:  cond = cond_e::b;   break;
+                    case mnem_e::BGEU:  cond = cond_e::ae;  break;
+
+                    default:  break;
+                }
+
+                get( reg_e::rax, instr.rs1 );
+                get( reg_e::rcx, instr.rs2 );
+                x.alu_rr( alu_e::cmp, reg_e::rax, reg_e::rcx );
+                const auto taken = x.jcc( cond );
+                chain_exit( i_ + 1, next_pc );
+                x.bind( taken );
+                chain_exit( i_ + 1, instr_pc + instr.imm );
+
+                break;
+            }
+            case opcode_e::auipc:
+            case opcode_e::lui: {
+                if ( !rd ) { break; }  // no side effects
+
+                const bool auipc = instr.opcode == opcode_e::auipc;
+                x.mov_ri( reg_e::rax,
+                          auipc ? instr_pc + instr.imm : instr.imm );
+                put( rd, reg_e::rax );
+
+                break;
+            }
+            case opcode_e::jal: {
+                x.mov_ri( reg_e::rax, next_pc );
+                put( rd, reg_e::rax );
+                chain_exit( i_ + 1, instr_pc + instr.imm );
+
+                break;
+            }
+            case opcode_e::jalr: {
+                // target first; `rd` may equal `rs1`
+                get( reg_e::rax, instr.rs1 );
+                x.alu_ri( alu_e::add, reg_e::rax, instr.imm );
+                x.alu_ri( alu_e::and_, reg_e::rax, ~word_mask( 0, 0 ) );
+                x.mov_mr( reg_e::rdi, pc_disp, reg_e::rax );
+                x.mov_ri( reg_e::rcx, next_pc );
+                put( rd, reg_e::rcx );
+                exit( i_ + 1, false );
+
+                break;
+            }
+
+            default:  break;  // `FENCE`; a no-op
+        }
+    }
+
+    // fall through to the next block
+    if ( !ends_block( instr_vec.back() ) ) {
+        chain_exit( instr_vec.size(), pc + instr_vec.size() * iword_size );
+    }
+
+    for ( const auto &stub : stub_vec ) {
+        x.bind( stub.label );
+        set_pc( stub.pc );
+        exit( stub.retired, true );
+    }
+
+    // before the prologue; nothing to restore
+    x.bind( over_budget );
+    set_pc( pc );
+    x.mov_ri( reg_e::rax, 0 );
+    x.ret();
+
+    return x.is_ok() ? x.get_size() : 0;
+}
+
+}  // END namespace cpu_emu::cpu
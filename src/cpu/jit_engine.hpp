@@ -0,0 +1,141 @@
+#pragma once
+
+// jit engine
+
+
+
+// INCLUDES
+
+#include "code_map.hpp"
+#include "defines.h"
+#include "isa.hpp"
+#include "profiler.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace cpu_emu::cpu {
+
+// FORWARD DECLARATIONS
+
+class Cpu;
+
+
+
+// CLASS DEFINITIONS
+
+// An execution engine that translates guest basic blocks into native x86-64
+// code (dynamic binary translation); on other hosts, or if the code buffer
+// cannot be mapped, it falls back to the reference interpreter, `Cpu::step`.
+// Within a block, frequently used guest registers live in host registers.
+// Instructions that are not translated (e.g., `ECALL`, `FENCE_I`) end the
+// block; out-of-bounds accesses and stores to pages of translated code leave
+// the block before the instruction, which is then executed (or trapped) by
+// `Cpu::step`. Such a store drops exactly the blocks it overlaps. Unless
+// profiling, block exits to direct targets jump straight to the target block
+// once it is translated (chaining), until the step budget runs out; dropping
+// a block unlinks it. Other stores are unseen by the decode cache and the
+// threaded engine, so decodes made while this engine runs lie within its
+// blocks and go with them, and `Cpu` drops the rest when switching to it.
+class Jit_engine final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    static constexpr auto iword_length = isa::iword_length;
+    static constexpr auto reg_count    = isa::reg_count;
+    static constexpr std::size_t block_max_length = BLOCK_MAX_LENGTH;
+    static constexpr std::size_t code_buffer_size = JIT_BUFFER_SIZE;
+    static constexpr unsigned page_length = MEM_PAGE_LENGTH;  // dirty pages
+    using word_t  = isa::word_t;
+    using addr_t  = isa::addr_t;
+    using instr_t = isa::instr_t;
+    using uint8_t = isa::uint8_t;
+
+    // state shared with the generated code; accessed by offset
+    struct context_t
+    {
+        word_t  *reg_carr;  // `Cpu::reg_arr`
+        uint8_t *mem_carr;  // guest memory
+        addr_t   pc;        // set by every block exit
+        isa::uint32_t budget;  // steps left; blocks enter only if all fit
+        uint8_t *dirty_carr;  // `Memory` dirty-page flags
+        const uint8_t *code_page_carr;  // `Code_map` flags
+    };  // END struct context_t
+
+    // returns whether to interpret the next instruction; retired
+    // instructions are taken off `budget`
+    using block_fn_t = isa::uint32_t (*)( context_t *context );
+
+    struct exit_t
+    {
+        addr_t      target;  // a direct target
+        std::size_t patch_offset;  // past the rel32 of its `jmp`; in the buffer
+    };  // END struct exit_t
+
+    struct block_t
+    {
+        block_fn_t  fn;
+        std::size_t code_offset;  // of `fn`; in the buffer
+        addr_t      end_pc;      // address past the last instruction
+        std::size_t length;      // instruction count
+        bool        breakpoint;  // the block starts at a breakpoint
+        Profiler::block_t *profile;  // counters; set while profiling
+        std::vector< exit_t > exit_vec;  // chainable
+    };  // END struct block_t
+
+
+// DATA MEMBERS
+private:
+    std::unordered_map< addr_t, block_t > block_map;
+    // by target; pcs of the blocks with it as a direct target
+    std::unordered_map< addr_t, std::vector< addr_t > > source_map;
+    Code_map code_map;
+    std::vector< addr_t > invalid_vec;  // blocks to drop; deferred
+    uint8_t    *code_carr     = nullptr;  // executable code buffer
+    std::size_t code_size     = 0;        // used bytes
+    bool        code_failed   = false;    // buffer could not be mapped
+    context_t   context       = {
+        nullptr, nullptr, 0, 0, nullptr, nullptr
+    };
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Jit_engine();
+    Jit_engine( const Jit_engine & ) = delete;
+    Jit_engine &operator=( const Jit_engine & ) = delete;
+    ~Jit_engine();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    void run( Cpu &cpu, std::size_t step_count );
+    void invalidate( addr_t addr, addr_t size );
+    void drop_invalid( Cpu &cpu );  // the blocks invalidated; else by `run`
+    void clear();  // the decode cache must be cleared with it
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    bool map_code_buffer();
+    block_t &find_block( Cpu &cpu, addr_t pc );
+    void drop_block( Cpu &cpu, addr_t pc );
+    // points the exit at the target's code, or back at its own return
+    void link( const exit_t &exit, const block_t *target );
+    block_t translate( Cpu &cpu, addr_t pc );
+    static bool translatable( const instr_t &instr );
+    static bool ends_block( const instr_t &instr );
+    static std::size_t emit_block(
+        const std::vector< instr_t > &instr_vec,
+        addr_t pc,
+        addr_t mem_size,
+        uint8_t *begin_ptr,
+        uint8_t *end_ptr,
+        std::vector< exit_t > &exit_vec  // offsets from `begin_ptr`
+    );  // returns the code size; 0 on overflow
+};  // END class Jit_engine
+
+}  // END namespace cpu_emu::cpu
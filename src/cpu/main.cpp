@@ -4,13 +4,30 @@
 
 // INCLUDES
 
+#include "branch.hpp"
+#include "cache.hpp"
 #include "cpu.hpp"
+#include "defines.h"
+#include "elf.hpp"
+#include "isa.hpp"
+#include "memory.hpp"
+#include "pipeline.hpp"
+#include "runner.hpp"
 
+#include <chrono>
+#include <cstddef>
 // #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <ios>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>  // getopt
 
 
 
@@ -19,17 +36,39 @@ namespace {
 // USED NAMESPACES
 
 using namespace cpu_emu::cpu;
+using namespace cpu_emu::memory;
+using namespace cpu_emu;
 // using namespace cpu_emu::isa;
 
+
+
+// CONSTEXPR DEFINITIONS
+
+constexpr std::size_t cache_top_count  = 10;  // pcs in the cache report
+constexpr std::size_t branch_top_count = 10;  // pcs in the branch report
+
 }  // END namespace
 
 
 
-// STATIC VARIABLES
+// STATIC FUNCTION DEFINITIONS
+
+// Parses a number or, for ELF executables, a symbol name.
+static
+isa::addr_t
+parse_addr(
+    const std::string &str,
+    const elf::Elf *elf
+)
+{
+    if ( elf ) {
+        if ( const auto *symbol = elf->find_symbol( str ) ) {
+            return symbol->addr;
+        }
+    }
 
-static std::size_t current_step_count;
-static std::size_t current_pc;
-static std::size_t current_sp;
+    return std::stoull( str, nullptr, 0 );
+}
 
 
 
@@ -37,14 +76,150 @@ static std::size_t current_sp;
 
 static
 void
-at_exit()
+at_exit(
+    const Cpu &cpu,
+    const run_result_t &result,
+    double elapsed_s
+)
 {
     std::cout << std::dec;
-    std::cout << "at_exit: current_step_count: " << current_step_count
+    std::cout << "at_exit: engine: " << engine_str( cpu.get_engine() )
+            << std::endl;
+    std::cout << "at_exit: stop: " << stop_str( result.stop ) << std::endl;
+    if ( result.stop == stop_e::trap ) {
+        std::cout << "at_exit: trap: " << trap_str( result.trap.cause )
+                << std::endl;
+    }
+    std::cout << "at_exit: current_step_count: " << result.step_count
             << std::endl;
     std::cout << std::hex << std::showbase;
-    std::cout << "at_exit: current_pc: " << current_pc << std::endl;
-    std::cout << "at_exit: current_sp: " << current_sp << std::endl;
+    std::cout << "at_exit: current_pc: " << result.pc << std::endl;
+    std::cout << "at_exit: current_sp: " << cpu.get_sp_reg() << std::endl;
+    if ( result.stop == stop_e::trap ) {
+        // the pc is that of the trapping instruction
+        std::cout << "at_exit: trap_value: " << result.trap.value << std::endl;
+    }
+    if ( const auto &elf = cpu.get_mem().get_elf() ) {
+        if ( const auto *symbol = elf->find_symbol( result.pc ) ) {
+            std::cout << "at_exit: current_symbol: " << symbol->name << "+"
+                    << result.pc - symbol->addr << std::endl;
+        }
+    }
+    std::cout << std::dec << std::noshowbase;
+    std::cout << "at_exit: elapsed_s: " << elapsed_s << std::endl;
+    std::cout << "at_exit: mips: "
+            << result.step_count / elapsed_s / 1e6 << std::endl;
+}
+
+
+
+// BATCH FUNCTION DEFINITIONS
+
+// writes `str` to `os` with every line prefixed by `prefix`
+static
+void
+print_prefixed(
+    std::ostream &os,
+    const std::string &prefix,
+    const std::string &str
+)
+{
+    for ( std::size_t begin = 0;  begin < str.size(); ) {
+        auto end = str.find( '\n', begin );
+        if ( end == std::string::npos ) { end = str.size(); }
+        os << prefix << std::string_view( str ).substr( begin, end - begin )
+           << '\n';
+        begin = end + 1;
+    }
+}
+
+// writes `str` to the file at `file_path`
+static
+void
+write_file(
+    const std::string &file_path,
+    const std::string &str
+)
+{
+    std::ofstream ofs( file_path, std::ios::binary );
+    if ( !ofs.write( str.data(), str.size() ) ) {
+        throw std::runtime_error( "Could not write '" + file_path + "'." );
+    }
+}
+
+static
+int
+run_batch(
+    const Image &image,
+    const runner_config_t &runner_config,
+    std::size_t instance_count,
+    const std::string &out_dir  // empty: print the guest output prefixed
+)
+{
+    // every instance reads the same input
+    const std::string input(
+        (std::istreambuf_iterator< char >( std::cin )),
+        std::istreambuf_iterator< char >()
+    );
+
+    const Runner runner( image, runner_config );
+    const auto result = runner.run(
+        std::vector< std::string >( instance_count, input ) );
+
+    // the guest output of every instance, in input order
+    for ( std::size_t i_ = 0;  i_ < result.instance_vec.size();  ++i_ ) {
+        const auto &instance = result.instance_vec[ i_ ];
+        const auto index_str = std::to_string( i_ );
+
+        if ( out_dir.empty() ) {
+            print_prefixed( std::cout, index_str + ": ", instance.out_str );
+            print_prefixed( std::cerr, index_str + ": ", instance.err_str );
+        } else {
+            write_file( out_dir + "/" + index_str + ".out", instance.out_str );
+            write_file( out_dir + "/" + index_str + ".err", instance.err_str );
+        }
+    }
+    std::cout << std::flush;
+    std::cerr << std::flush;
+
+    bool faulted = false;
+    for ( std::size_t i_ = 0;  i_ < result.instance_vec.size();  ++i_ ) {
+        const auto &instance = result.instance_vec[ i_ ];
+        const auto &run_result = instance.run_result;
+
+        std::cout << "instance: " << i_
+                  << ": stop: " << (instance.fault.empty()
+                                    ? stop_str( run_result.stop ) : "fault")
+                  << ", exit_status: " << run_result.exit_status
+                  << ", step_count: " << run_result.step_count
+                  << ", elapsed_s: " << instance.elapsed_s
+                  << ", mips: "
+                  << run_result.step_count / instance.elapsed_s / 1e6;
+        if ( run_result.stop == stop_e::trap ) {
+            std::cout << ", trap: " << trap_str( run_result.trap.cause )
+                      << std::hex << std::showbase
+                      << ", trap_pc: " << run_result.trap.pc
+                      << ", trap_value: " << run_result.trap.value
+                      << std::dec << std::noshowbase;
+            faulted = true;
+        }
+        if ( !instance.fault.empty() ) {
+            std::cout << ", fault: " << instance.fault;
+            faulted = true;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "at_exit: engine: " << engine_str( runner_config.engine )
+              << std::endl;
+    std::cout << "at_exit: instance_count: " << instance_count << std::endl;
+    std::cout << "at_exit: thread_count: " << result.thread_count << std::endl;
+    std::cout << "at_exit: step_count: " << result.step_count << std::endl;
+    std::cout << "at_exit: elapsed_s: " << result.elapsed_s << std::endl;
+    std::cout << "at_exit: mips: "
+              << result.step_count / result.elapsed_s / 1e6 << std::endl;
+
+    return faulted ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 
@@ -57,9 +232,149 @@ main(
     char *argv[]
 )
 {
+    const std::string usage = std::string( "Usage: " ) + argv[ 0 ]
+            + " [-e <engine>] [-b <pc>]... [-i <mem_img_path>] [-c [-w]]"
+            + " [-d <dump_path>] [-p <top_count>] [-T <trace_path>]"
+            + " [-R <checkpoint_path>] [-C <checkpoint_path>] [-M <cache_spec>]"
+            + " [-B <predictor>] [-P <timing_spec>]"
+            + " [-n <instance_count> [-t <thread_count>] [-a] [-o <out_dir>]]"
+            + " [<step_count>] [<pc>] [<sp>]\n"
+            + "  <engine>: interp (default), threaded, jit\n"
+            + "  -b: stop before executing the instruction at <pc>;"
+            + " a symbol name for ELF executables\n"
+            + "  -i: memory image or RV32 ELF executable;"
+            + " " MEM_IMG_PATH " by default\n"
+            + "  -c: copy-on-write; the memory image is not modified\n"
+            + "  -w: with -c, write modified pages back to the image at exit\n"
+            + "  -d: dump the memory to <dump_path> at exit\n"
+            + "  -p: profile; report the <top_count> hottest blocks, pcs,"
+            + " and branches at exit\n"
+            + "  -T: trace every executed instruction to <trace_path>;"
+            + " runs on the interpreter; see trace_dump\n"
+            + "  -R: resume from the last checkpoint in <checkpoint_path>;"
+            + " the image must be the one checkpointed\n"
+            + "  -C: write a checkpoint to <checkpoint_path> at exit;"
+            + " incremental if it is the file resumed from\n"
+            + "  -M: model the caches and report their miss rates at exit;"
+            + " runs on the interpreter; <cache_spec>: default, or e.g."
+            + " l1d:32k:8:64:lru,l2:1m:16:64:random\n"
+            + "  -B: model branch prediction and report mispredictions at exit;"
+            + " runs on the interpreter;"
+            + " <predictor>: static, bimodal, gshare, tage\n"
+            + "  -P: model the timing of a 5-stage in-order pipeline, with"
+            + " the -M and -B models if given, and report cycles and CPI at"
+            + " exit; runs on the interpreter; <timing_spec>: default, or"
+            + " e.g. load_use=2,mispredict=3,mem=200\n"
+            + "  -n: run <instance_count> copy-on-write instances of the image,"
+            + " each with all of the standard input, on a thread pool\n"
+            + "  -t: with -n, use <thread_count> threads; one per cpu by default\n"
+            + "  -a: with -n, pin each thread to a cpu\n"
+            + "  -o: with -n, write the output of instance i to"
+            + " <out_dir>/i.out and <out_dir>/i.err; by default, it is"
+            + " printed with every line prefixed by i";
+
+    engine_e engine = engine_e::interp;
+    stop_conditions_t stop_conditions;
+    std::string mem_img_path = MEM_IMG_PATH;
+    map_e mem_map = map_e::shared;
+    bool write_back = false;
+    std::string dump_path;
+    std::size_t top_count = 0;  // 0: no profile
+    std::string trace_path;
+    std::string resume_path;
+    std::string checkpoint_path;
+    std::string cache_spec;
+    bool branch_modeling = false;
+    branch::predictor_e predictor = branch::predictor_e::gshare;
+    std::string timing_spec;
+    std::vector< std::string > breakpoint_str_vec;  // resolved once loaded
+    std::size_t instance_count = 0;  // 0: no batch
+    std::string out_dir;  // empty: print the batch output
+    runner_config_t runner_config;
+
+    const char *const opt_str = "e:b:i:cwd:p:T:R:C:M:B:P:n:t:ao:";
+    for ( int opt; (opt = getopt( argc, argv, opt_str )) != -1; ) {
+        switch ( opt ) {
+            case 'n':
+                instance_count = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 't':
+                runner_config.thread_count = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 'a':
+                runner_config.affinity = true;
+
+                break;
+            case 'o':
+                out_dir = optarg;
+
+                break;
+            case 'i':
+                mem_img_path = optarg;
+
+                break;
+            case 'c':
+                mem_map = map_e::copy_on_write;
+
+                break;
+            case 'w':
+                write_back = true;
+
+                break;
+            case 'd':
+                dump_path = optarg;
+
+                break;
+            case 'p':
+                top_count = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 'T':
+                trace_path = optarg;
+
+                break;
+            case 'R':
+                resume_path = optarg;
+
+                break;
+            case 'C':
+                checkpoint_path = optarg;
+
+                break;
+            case 'M':
+                cache_spec = optarg;
+
+                break;
+            case 'P':
+                timing_spec = optarg;
+
+                break;
+            case 'B':
+                branch_modeling = branch::parse_predictor( optarg, predictor );
+                if ( branch_modeling ) { break; }
+                std::cout << usage << std::endl;
+
+                return EXIT_FAILURE;
+            case 'b':
+                breakpoint_str_vec.push_back( optarg );
+
+                break;
+            case 'e':
+                if ( parse_engine( optarg, engine ) ) { break; }
+                [[fallthrough]];
+            default:
+                std::cout << usage << std::endl;
+
+                return EXIT_FAILURE;
+        }
+    }
+    argc -= optind - 1;  // positional arguments; keep `argv[ 0 ]`
+    argv += optind - 1;
+
     if ( argc > 4 ) {
-        std::cout << "Usage: " << argv[ 0 ] << " [<step_count>] [<pc>] [<sp>]"
-                << std::endl;
+        std::cout << usage << std::endl;
 
         return EXIT_FAILURE;
     }
@@ -74,23 +389,103 @@ main(
                    ? std::stoull( argv[ 3 ], nullptr, 0 )
                    : 0;
 
-    Cpu cpu;
+    if ( instance_count ) {
+        if (
+            write_back || !dump_path.empty() || top_count
+         || !trace_path.empty() || !resume_path.empty()
+         || !checkpoint_path.empty() || !cache_spec.empty() || branch_modeling
+         || !timing_spec.empty()
+        ) {
+            std::cout << usage << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        const Image image( mem_img_path );
+        const auto *elf = image.get_elf().get();
+        for ( const auto &str : breakpoint_str_vec ) {
+            stop_conditions.breakpoint_vec.push_back( parse_addr( str, elf ) );
+        }
+
+        runner_config.engine          = engine;
+        runner_config.max_steps       = step_count;
+        runner_config.stop_conditions = stop_conditions;
+        if ( elf ) { runner_config.pc_reg = elf->get_entry(); }
+        if ( argc > 2 ) { runner_config.pc_reg = pc; }
+        if ( argc > 3 ) { runner_config.sp_reg = sp; }
+
+        return run_batch( image, runner_config, instance_count, out_dir );
+    }
+
+    if ( !out_dir.empty() ) {
+        std::cout << usage << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    Cpu cpu( ENTRY_POINT_ADDR, STACK_START_ADDR, mem_img_path, mem_map );
+    const auto *elf = cpu.get_mem().get_elf().get();
+    if ( write_back && elf ) {
+        std::cout << usage << std::endl;
+
+        return EXIT_FAILURE;
+    }
+    for ( const auto &str : breakpoint_str_vec ) {
+        stop_conditions.breakpoint_vec.push_back( parse_addr( str, elf ) );
+    }
+    if ( elf ) { cpu.set_pc_reg( elf->get_entry() ); }
     if ( argc > 2 ) { cpu.set_pc_reg( pc ); }
     if ( argc > 3 ) { cpu.set_sp_reg( sp ); }
+    cpu.set_engine( engine );
+    if ( top_count ) { cpu.set_profiling( true ); }
+    if ( !resume_path.empty() ) { cpu.resume( resume_path ); }
+    if ( !trace_path.empty() ) { cpu.start_trace( trace_path ); }
+    if ( !cache_spec.empty() ) {
+        cpu.start_cache_model( cache::parse_hierarchy_config( cache_spec ) );
+    }
+    if ( branch_modeling ) { cpu.start_branch_model( predictor ); }
+    if ( !timing_spec.empty() ) {
+        cpu.start_timing_model( pipeline::parse_timing_config( timing_spec ) );
+    }
 
-    if ( std::atexit( at_exit ) ) { return EXIT_FAILURE; }
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto result = cpu.run( step_count, stop_conditions );
+    const std::chrono::duration< double > elapsed =
+            std::chrono::steady_clock::now() - start_time;
 
-    for (
-        std::size_t i_ = 0;
-        i_ < step_count;
-        ++i_
-    ) {
-        current_step_count = i_ + 1;
-        current_pc = cpu.get_pc_reg();
-        current_sp = cpu.get_sp_reg();
+    at_exit( cpu, result, elapsed.count() );
 
-        cpu.step();
+    if ( !trace_path.empty() ) {
+        std::cout << "at_exit: trace_record_count: " << cpu.stop_trace()
+                  << std::endl;
+    }
+    if ( !checkpoint_path.empty() ) {
+        std::cout << "at_exit: checkpoint_page_count: "
+                  << cpu.checkpoint( checkpoint_path ) << std::endl;
     }
 
-    return EXIT_SUCCESS;
+    if ( write_back ) {
+        std::cout << "at_exit: written_back_pages: "
+                << cpu.get_mem().write_back() << std::endl;
+    }
+    if ( !dump_path.empty() ) { cpu.get_mem().dump( dump_path ); }
+    if ( top_count ) {
+        cpu.get_profiler()->report( std::cout, cpu.get_mem(), top_count );
+    }
+    if ( !cache_spec.empty() ) {
+        cpu.get_cache_model()->report(
+                std::cout, cpu.get_mem(), cache_top_count );
+    }
+    if ( branch_modeling ) {
+        cpu.get_branch_model()->report(
+                std::cout, cpu.get_mem(), branch_top_count );
+    }
+    if ( !timing_spec.empty() ) { cpu.get_timing_model()->report( std::cout ); }
+
+    switch ( result.stop ) {
+        case stop_e::exit:  return static_cast< int >( result.exit_status );
+        case stop_e::trap:  return EXIT_FAILURE;
+
+        default:  return EXIT_SUCCESS;
+    }
 }
@@ -16,8 +16,22 @@
 #include "memory.hpp"
 
 #include "../util/file_utils.hpp"
+#include "defines.h"
+#include "elf.hpp"
 #include "isa.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <setjmp.h>  // siglongjmp
+#include <signal.h>  // sigaction
+
 
 
 namespace {
@@ -25,6 +39,152 @@ namespace {
 // USED NAMESPACES
 
 using namespace cpu_emu::isa;
+using cpu_emu::memory::Memory;
+
+
+
+// VARIABLE DEFINITIONS
+
+// the recovery point armed on this thread, if any; read by `on_sigsegv`
+thread_local std::atomic< cpu_emu::memory::recovery_t * > armed_recovery;
+
+struct sigaction prev_sigsegv_action;
+
+
+
+// FUNCTION DEFINITIONS
+
+// Returns to the recovery point armed for the memory at `mem_carr`, if any;
+// throws otherwise.
+[[maybe_unused, noreturn]]
+void
+out_of_bounds(
+    const std::uint8_t *mem_carr
+)
+{
+    auto *const recovery = armed_recovery.load( std::memory_order_relaxed );
+    if ( recovery && recovery->base == mem_carr ) {
+        siglongjmp( recovery->env, 1 );
+    }
+
+    throw std::out_of_range( "Address out of bounds." );
+}
+
+// Leaves through `out_of_bounds` unless [addr, addr + size) is within the
+// memory. With `MEM_GUARD`, the access faults on the guard pages instead.
+inline
+void
+check_bounds(
+    [[maybe_unused]] const std::uint8_t *mem_carr,
+    [[maybe_unused]] addr_t addr,
+    [[maybe_unused]] addr_t mem_size,
+    [[maybe_unused]] addr_t size
+)
+{
+#if !MEM_GUARD
+    if ( addr >= mem_size - (size - 1) ) { out_of_bounds( mem_carr ); }
+#endif
+}
+
+// Returns a fault inside the reservation of the memory whose recovery point
+// is armed on this thread to that point, as `out_of_bounds` would have.
+// `SA_NODEFER` keeps the signal unblocked afterwards, as `siglongjmp` to a
+// point set by `sigsetjmp( env, 0 )` does not restore the signal mask.
+// Other faults go to the previous action; the handler stays installed.
+void
+on_sigsegv(
+    int sig,
+    siginfo_t *info,
+    void *context
+)
+{
+    const auto fault_addr = reinterpret_cast< std::uintptr_t >( info->si_addr );
+
+    auto *const recovery = armed_recovery.load( std::memory_order_relaxed );
+    if (
+        recovery
+     && fault_addr - reinterpret_cast< std::uintptr_t >( recovery->base )
+            < Memory::reserve_size
+    ) {
+        siglongjmp( recovery->env, 1 );
+    }
+
+    if ( prev_sigsegv_action.sa_flags & SA_SIGINFO ) {
+        prev_sigsegv_action.sa_sigaction( sig, info, context );
+    }
+    else if (
+        prev_sigsegv_action.sa_handler != SIG_DFL
+     && prev_sigsegv_action.sa_handler != SIG_IGN
+    ) {
+        prev_sigsegv_action.sa_handler( sig );
+    }
+    else {
+        // the default action, which ignoring a fault would loop on; the
+        // re-executed access faults again and terminates the process
+        signal( SIGSEGV, SIG_DFL );
+    }
+}
+
+// Reserves the address space of one `Memory`, installing the handler first.
+[[maybe_unused]]
+std::uint8_t *
+reserve_guarded()
+{
+    static const bool installed = []
+    {
+        struct sigaction action{};
+        action.sa_sigaction = on_sigsegv;
+        action.sa_flags     = SA_SIGINFO | SA_NODEFER;
+        sigemptyset( &action.sa_mask );
+
+        return !sigaction( SIGSEGV, &action, &prev_sigsegv_action );
+    }();
+    if ( !installed ) {
+        throw std::runtime_error( "Could not install the SIGSEGV handler." );
+    }
+
+    return cpu_emu::util::reserve_addr_space( Memory::reserve_size );
+}
+
+// Returns `nullptr` unless the file is an ELF executable.
+std::shared_ptr< const cpu_emu::elf::Elf >
+open_elf(
+    int fd
+)
+{
+    if ( !cpu_emu::elf::is_elf( fd ) ) { return nullptr; }
+
+    return std::make_shared< const cpu_emu::elf::Elf >( fd );
+}
+
+std::shared_ptr< const cpu_emu::elf::Elf >
+open_elf(
+    const std::string &file_path
+)
+{
+    const auto pair = cpu_emu::util::open_file( file_path );
+
+    std::shared_ptr< const cpu_emu::elf::Elf > elf;
+    try {
+        elf = open_elf( pair.first );
+    }
+    catch ( ... ) {
+        cpu_emu::util::close_file( pair.first );
+        throw;
+    }
+    cpu_emu::util::close_file( pair.first );
+
+    return elf;
+}
+
+[[maybe_unused]]
+void
+release_guarded(
+    std::uint8_t *start_addr
+)
+{
+    cpu_emu::util::munmap_file( start_addr, Memory::reserve_size );
+}
 
 }  // END namespace
 
@@ -34,25 +194,153 @@ namespace cpu_emu::memory {
 
 // CONSTRUCTOR, DESTRUCTOR DEFINITIONS
 
-Memory::Memory(
+Image::Image(
     const std::string &file_path
-)
+):
+    file_path( file_path )
+{
+    const auto pair = util::open_file( file_path );
+
+    this->fd   = pair.first;
+    this->size = pair.second;
+
+    try {
+        this->elf = open_elf( this->fd );
+    }
+    catch ( ... ) {
+        util::close_file( this->fd );
+        throw;
+    }
+}
+
+Image::~Image()
+{
+    util::close_file( this->fd );
+}
+
+Memory::Memory(
+    const std::string &file_path,
+    map_e map
+):
+    file_path( file_path ),
+    elf( open_elf( file_path ) ),
+    map( this->elf ? map_e::elf : map )
+{
+    if ( this->elf ) {
+        const auto pair = util::open_file( file_path );
+        try {
+            this->map_elf( pair.first );
+        }
+        catch ( ... ) {
+            util::close_file( pair.first );
+            throw;
+        }
+        util::close_file( pair.first );
+    }
+    else {
+#if MEM_GUARD
+        this->mem_carr = reserve_guarded();
+        try {
+            this->mem_size = util::mmap_file(
+                file_path, map == map_e::copy_on_write,
+                this->mem_carr, reserve_size - page_size
+            ).second;
+        }
+        catch ( ... ) {
+            release_guarded( this->mem_carr );
+            throw;
+        }
+#else
+        auto pair = util::mmap_file( file_path, map == map_e::copy_on_write );
+
+        this->mem_carr = pair.first;
+        this->mem_size = pair.second;
+#endif
+    }
+
+    this->dirty_vec.resize(
+        (std::size_t( this->mem_size ) + page_size - 1) >> page_length );
+    this->snapshot_dirty_vec.resize( this->dirty_vec.size() );
+    this->checkpoint_dirty_vec.resize( this->dirty_vec.size(), 1 );
+    this->map_dirty_vec.resize( this->dirty_vec.size() );
+}
+
+Memory::Memory(
+    const Image &image
+):
+    file_path( image.get_file_path() ),
+    elf( image.get_elf() ),
+    map( this->elf ? map_e::elf : map_e::copy_on_write )
 {
-    auto pair = util::mmap_file( file_path );
+    if ( this->elf ) {
+        this->map_elf( image.get_fd() );
+    }
+    else {
+        // whole pages, as `util::mmap_file` maps
+        const std::size_t size = util::page_ceil( image.get_size() );
+#if MEM_GUARD
+        if ( size > reserve_size - page_size ) {
+            throw std::length_error( "File too large for the reservation." );
+        }
+
+        this->mem_carr = reserve_guarded();
+        try {
+            util::mmap_fd( image.get_fd(), size, this->mem_carr );
+        }
+        catch ( ... ) {
+            release_guarded( this->mem_carr );
+            throw;
+        }
+#else
+        this->mem_carr = util::mmap_fd( image.get_fd(), size );
+#endif
+        this->mem_size = size;
+    }
 
-    this->mem_carr = pair.first;
-    this->mem_size = pair.second;
+    this->dirty_vec.resize(
+        (std::size_t( this->mem_size ) + page_size - 1) >> page_length );
+    this->snapshot_dirty_vec.resize( this->dirty_vec.size() );
+    this->checkpoint_dirty_vec.resize( this->dirty_vec.size(), 1 );
+    this->map_dirty_vec.resize( this->dirty_vec.size() );
 }
 
 Memory::~Memory()
 {
+#if MEM_GUARD
+    release_guarded( this->mem_carr );
+#else
     util::munmap_file( this->mem_carr, this->mem_size );
+#endif
 }
 
 
 
 // PUBLIC MEMBER-FUNCTION DEFINITIONS
 
+const std::string &
+Image::get_file_path() const
+{
+    return this->file_path;
+}
+
+int
+Image::get_fd() const
+{
+    return this->fd;
+}
+
+std::size_t
+Image::get_size() const
+{
+    return this->size;
+}
+
+const std::shared_ptr< const elf::Elf > &
+Image::get_elf() const
+{
+    return this->elf;
+}
+
 const uint8_t *
 Memory::get_mem_carr(
     addr_t addr
@@ -83,14 +371,180 @@ Memory::get_mem_size() const
     return this->mem_size;
 }
 
+const map_e &
+Memory::get_map() const
+{
+    return this->map;
+}
+
+const std::shared_ptr< const elf::Elf > &
+Memory::get_elf() const
+{
+    return this->elf;
+}
+
+std::size_t
+Memory::write_back() const
+{
+    // a shared mapping is its own write-back
+    if ( this->map == map_e::shared ) { return 0; }
+    if ( this->map == map_e::elf ) {
+        throw std::logic_error( "Cannot write back to an ELF executable." );
+    }
+
+    std::vector< std::size_t > page_vec;
+    for ( std::size_t page_ = 0;  page_ < this->dirty_vec.size();  ++page_ ) {
+        if ( this->dirty_vec[ page_ ] || this->map_dirty_vec[ page_ ] ) {
+            page_vec.push_back( page_ );
+        }
+    }
+
+    util::write_back_file(
+        this->file_path,
+        this->mem_carr,
+        this->mem_size,
+        page_size,
+        page_vec
+    );
+
+    return page_vec.size();
+}
+
+void
+Memory::dump(
+    const std::string &file_path
+) const
+{
+    util::dump_file( file_path, this->mem_carr, this->mem_size );
+}
+
+const std::vector< uint8_t > &
+Memory::get_dirty_vec() const
+{
+    return this->dirty_vec;
+}
+
+uint8_t *
+Memory::get_dirty_carr_nc()
+{
+    return this->dirty_vec.data();
+}
+
+void
+Memory::mark_dirty(
+    addr_t addr,
+    addr_t size
+)
+{
+    if ( !size || addr >= this->mem_size ) { return; }
+
+    const addr_t last = std::min( addr + (size - 1), this->mem_size - 1 );
+
+    for (
+        addr_t page_ = addr >> page_length;
+        page_ <= last >> page_length;
+        ++page_
+    ) {
+        this->dirty_vec[ page_ ] = 1;
+    }
+}
+
+void
+Memory::snapshot()
+{
+    this->snapshot_vec.assign( this->mem_carr, this->mem_carr + this->mem_size );
+    for ( std::size_t page_ = 0;  page_ < this->dirty_vec.size();  ++page_ ) {
+        this->checkpoint_dirty_vec[ page_ ] |= this->dirty_vec[ page_ ];
+        this->map_dirty_vec[ page_ ]        |= this->dirty_vec[ page_ ];
+    }
+    std::fill( this->dirty_vec.begin(), this->dirty_vec.end(), 0 );
+    std::fill(
+        this->snapshot_dirty_vec.begin(), this->snapshot_dirty_vec.end(), 0 );
+}
+
+void
+Memory::restore()
+{
+    if ( this->snapshot_vec.empty() ) {
+        throw std::logic_error( "No snapshot to restore." );
+    }
+
+    for ( std::size_t page_ = 0;  page_ < this->dirty_vec.size();  ++page_ ) {
+        if ( !this->is_dirty_since_snapshot( page_ ) ) { continue; }
+
+        const std::size_t offset = page_ << page_length;
+        std::memcpy(
+            this->mem_carr + offset,
+            this->snapshot_vec.data() + offset,
+            std::min< std::size_t >( page_size, this->mem_size - offset )
+        );
+        this->dirty_vec[ page_ ]            = 0;
+        this->snapshot_dirty_vec[ page_ ]   = 0;
+        this->checkpoint_dirty_vec[ page_ ] = 1;
+        this->map_dirty_vec[ page_ ]        = 1;
+    }
+}
+
+bool
+Memory::is_dirty_since_snapshot(
+    std::size_t page
+) const
+{
+    return this->dirty_vec[ page ] || this->snapshot_dirty_vec[ page ];
+}
+
+std::vector< addr_t >
+Memory::take_checkpoint_pages()
+{
+    std::vector< addr_t > page_vec;
+    for ( std::size_t page_ = 0;  page_ < this->dirty_vec.size();  ++page_ ) {
+        if ( this->dirty_vec[ page_ ] || this->checkpoint_dirty_vec[ page_ ] ) {
+            page_vec.push_back( page_ );
+        }
+        this->snapshot_dirty_vec[ page_ ] |= this->dirty_vec[ page_ ];
+        this->map_dirty_vec[ page_ ]      |= this->dirty_vec[ page_ ];
+        this->dirty_vec[ page_ ]            = 0;
+        this->checkpoint_dirty_vec[ page_ ] = 0;
+    }
+
+    return page_vec;
+}
+
+void
+Memory::arm(
+    recovery_t &recovery
+) const
+{
+    recovery.base = this->mem_carr;
+    recovery.prev = armed_recovery.load( std::memory_order_relaxed );
+    armed_recovery.store( &recovery, std::memory_order_relaxed );
+    std::atomic_signal_fence( std::memory_order_seq_cst );
+}
+
+void
+Memory::disarm(
+    recovery_t &recovery
+)
+{
+    std::atomic_signal_fence( std::memory_order_seq_cst );
+    armed_recovery.store( recovery.prev, std::memory_order_relaxed );
+}
+
+bool
+Memory::is_in_bounds(
+    addr_t addr,
+    addr_t size
+) const
+{
+    return addr < this->mem_size && this->mem_size - addr >= size;
+}
+
 uint8_t
 Memory::lb(
     addr_t addr
 ) const
 {
-    if ( addr >= this->mem_size ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 1 );
 
     return *reinterpret_cast< uint8_t * >( this->mem_carr + addr );
 }
@@ -100,9 +554,7 @@ Memory::lh(
     addr_t addr
 ) const
 {
-    if ( addr >= this->mem_size - 1 ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 2 );
 
     return *reinterpret_cast< uint16_t * >( this->mem_carr + addr );
 }
@@ -112,9 +564,7 @@ Memory::lw(
     addr_t addr
 ) const
 {
-    if ( addr >= this->mem_size - 3 ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 4 );
 
     return *reinterpret_cast< uint32_t * >( this->mem_carr + addr );
 }
@@ -124,9 +574,7 @@ Memory::ld(
     addr_t addr
 ) const  // rv64i
 {
-    if ( addr >= this->mem_size - 7 ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 8 );
 
     return *reinterpret_cast< uint64_t * >( this->mem_carr + addr );
 }
@@ -137,11 +585,10 @@ Memory::sb(
     uint8_t word8
 )
 {
-    if ( addr >= this->mem_size ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 1 );
 
     *reinterpret_cast< uint8_t * >( this->mem_carr + addr ) = word8;
+    this->dirty_vec[ addr >> page_length ] = 1;
 }
 
 void
@@ -150,11 +597,11 @@ Memory::sh(
     uint16_t word16
 )
 {
-    if ( addr >= this->mem_size - 1 ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 2 );
 
     *reinterpret_cast< uint16_t * >( this->mem_carr + addr ) = word16;
+    this->dirty_vec[ addr       >> page_length ] = 1;  // may cross pages
+    this->dirty_vec[ (addr + 1) >> page_length ] = 1;
 }
 
 void
@@ -163,11 +610,11 @@ Memory::sw(
     uint32_t word32
 )
 {
-    if ( addr >= this->mem_size - 3 ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 4 );
 
     *reinterpret_cast< uint32_t * >( this->mem_carr + addr ) = word32;
+    this->dirty_vec[ addr       >> page_length ] = 1;  // may cross pages
+    this->dirty_vec[ (addr + 3) >> page_length ] = 1;
 }
 
 void
@@ -176,11 +623,97 @@ Memory::sd(
     uint64_t word64
 )  // rv64i
 {
-    if ( addr >= this->mem_size - 7 ) {
-        throw std::out_of_range( "Address out of bounds." );
-    }
+    check_bounds( this->mem_carr, addr, this->mem_size, 8 );
 
     *reinterpret_cast< uint64_t * >( this->mem_carr + addr ) = word64;
+    this->dirty_vec[ addr       >> page_length ] = 1;  // may cross pages
+    this->dirty_vec[ (addr + 7) >> page_length ] = 1;
+}
+
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+void
+Memory::map_elf(
+    int fd
+)
+{
+    const auto &segment_vec = this->elf->get_segment_vec();
+
+    // the stack starts at the end of memory
+    std::uint64_t end = STACK_START_ADDR;
+    for ( const auto &segment : segment_vec ) {
+        end = std::max< std::uint64_t >(
+                end, std::uint64_t( segment.vaddr ) + segment.mem_size );
+    }
+    const std::size_t page_mask = page_size - 1;
+    end = (end + page_mask) & ~std::uint64_t( page_mask );
+    if ( end >> addr_length ) {
+        throw std::length_error( "ELF segments too large." );
+    }
+    this->mem_size = end;
+
+#if MEM_GUARD
+    this->mem_carr = reserve_guarded();
+#else
+    this->mem_carr = nullptr;
+#endif
+    try {
+        // zero-filled pages are only allocated once touched
+        this->mem_carr = util::mmap_anonymous( this->mem_size, this->mem_carr );
+
+        for ( const auto &segment : segment_vec ) {
+            if ( !segment.file_size ) { continue; }  // e.g., only .bss
+
+            const std::size_t first      = segment.vaddr;
+            const std::size_t last       = first + segment.file_size;
+            const std::size_t page_first = first & ~page_mask;
+            const std::size_t page_last  = (last + page_mask) & ~page_mask;
+
+            // file pages can be mapped as such only if they are aligned like
+            // the segment and belong to no other segment
+            bool mappable = (segment.offset & page_mask) == (first & page_mask);
+            for ( const auto &other : segment_vec ) {
+                if (
+                    &other != &segment
+                 && other.vaddr < page_last
+                 && std::size_t( other.vaddr ) + other.mem_size > page_first
+                ) {
+                    mappable = false;
+                }
+            }
+
+            if ( mappable ) {
+                util::mmap_fd(
+                    fd, page_last - page_first,
+                    this->mem_carr + page_first,
+                    segment.offset - (first - page_first)
+                );
+                // the rest of the first and last page is not the segment's
+                std::memset(
+                    this->mem_carr + page_first, 0, first - page_first );
+                std::memset( this->mem_carr + last, 0, page_last - last );
+            }
+            else {
+                util::read_fd(
+                    fd, this->mem_carr + first,
+                    segment.file_size, segment.offset
+                );
+            }
+        }
+    }
+    catch ( ... ) {
+#if MEM_GUARD
+        release_guarded( this->mem_carr );
+#else
+        if ( this->mem_carr ) {
+            util::munmap_file( this->mem_carr, this->mem_size );
+        }
+#endif
+        throw;
+    }
 }
 
 }  // END namespace cpu_emu::memory
@@ -6,21 +6,90 @@
 
 // INCLUDES
 
+#include "defines.h"
+#include "elf.hpp"
 #include "isa.hpp"
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
+
+#include <setjmp.h>  // sigjmp_buf
 
 
 
 namespace cpu_emu::memory {
 
+// ENUM CLASS DEFINITIONS
+
+enum class map_e
+{
+    shared,         // stores are written through to the image file
+    copy_on_write,  // stores stay private; the image file is not modified
+    elf,            // copy-on-write segments of an ELF executable; zero-filled
+                    // elsewhere up to at least `STACK_START_ADDR`
+};  // END enum class map_e
+
+
+
+// STRUCT DEFINITIONS
+
+// Where an access past the end of a `Memory` returns to; see `Memory::arm`.
+struct recovery_t
+{
+    sigjmp_buf           env;
+    const isa::uint8_t  *base;  // of the memory armed for
+    recovery_t          *prev;  // armed before on the same thread
+};  // END struct recovery_t
+
+
+
 // CLASS DEFINITIONS
 
+// A memory image opened once and shared by any number of `Memory` instances,
+// each of which maps it copy-on-write; may be shared across threads.
+// The image may be a flat binary or an ELF executable.
+class Image final
+{
+// DATA MEMBERS
+private:
+    const std::string file_path;
+    int               fd;
+    std::size_t       size;
+    std::shared_ptr< const elf::Elf > elf;  // `nullptr` unless ELF
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    explicit Image( const std::string &file_path );
+    Image( const Image & ) = delete;
+    Image &operator=( const Image & ) = delete;
+    ~Image();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    const std::string &get_file_path() const;
+    int get_fd() const;
+    std::size_t get_size() const;
+    const std::shared_ptr< const elf::Elf > &get_elf() const;
+};  // END class Image
+
+// The memory of one guest: a flat image rounded up to whole pages, so that
+// the end of memory is where a guard fault or the bounds check would leave
+// the same access, or the segments of an ELF executable.
 class Memory final
 {
 // TYPE, CONSTEXPR MEMBERS
 public:
     static constexpr auto addr_length = isa::addr_length;
+    static constexpr unsigned page_length = MEM_PAGE_LENGTH;
+    static constexpr isa::addr_t page_size = isa::addr_t( 1 ) << page_length;
+    // with `MEM_GUARD`, the whole address space plus slack for the widest
+    // access is reserved, and everything past the image is inaccessible
+    static constexpr std::size_t reserve_size =
+            (std::size_t( 1 ) << addr_length) + page_size;
     using addr_t   = isa::addr_t;
     using uint8_t  = isa::uint8_t;
     using uint16_t = isa::uint16_t;
@@ -31,12 +100,30 @@ public:
 // DATA MEMBERS
 private:
     uint8_t *mem_carr;  // memory array; memory-mapped c-style array
-    addr_t   mem_size;  // memory array size
+    addr_t   mem_size;  // memory array size; whole pages
+    const std::string file_path;
+    const std::shared_ptr< const elf::Elf > elf;  // `nullptr` unless ELF
+    const map_e       map;  // `elf` if `elf` is set
+    std::vector< uint8_t > dirty_vec;     // one flag per page; set by stores
+    std::vector< uint8_t > snapshot_vec;  // memory at the last `snapshot`
+    // Pages dirtied since the last `snapshot` or checkpoint, respectively,
+    // whose flags in `dirty_vec` were cleared by the other; every page is
+    // dirty for the first checkpoint.
+    std::vector< uint8_t > snapshot_dirty_vec;
+    std::vector< uint8_t > checkpoint_dirty_vec;
+    // pages dirtied since mapping whose flags in `dirty_vec` were cleared;
+    // the pages `write_back` writes, with those in `dirty_vec`
+    std::vector< uint8_t > map_dirty_vec;
 
 
 // CONSTRUCTOR, DESTRUCTOR DECLARATIONS
 public:
-    explicit Memory( const std::string &file_path );
+    // `map` is ignored for ELF executables, which are always `map_e::elf`
+    explicit Memory( const std::string &file_path,
+                     map_e map = map_e::shared );
+    explicit Memory( const Image &image );  // copy-on-write
+    Memory( const Memory & ) = delete;
+    Memory &operator=( const Memory & ) = delete;
     ~Memory();
 
 
@@ -45,6 +132,30 @@ public:
     const uint8_t *get_mem_carr( addr_t addr = 0 ) const;
     uint8_t       *get_mem_carr_nc( addr_t addr = 0 );  // non-const
     const addr_t  &get_mem_size() const;
+    const map_e   &get_map() const;
+    const std::shared_ptr< const elf::Elf > &get_elf() const;
+    // Writes the pages dirtied since mapping back to the image, without
+    // reading it; returns their count. Throws for ELF executables.
+    std::size_t write_back() const;
+    void dump( const std::string &file_path ) const;
+    const std::vector< uint8_t > &get_dirty_vec() const;
+    uint8_t *get_dirty_carr_nc();  // for stores bypassing `sb`, `sh`, `sw`
+    void mark_dirty( addr_t addr, addr_t size );
+    void snapshot();
+    void restore();  // copies back the pages dirtied since `snapshot`
+    bool is_dirty_since_snapshot( std::size_t page ) const;
+    // Returns the pages dirtied since the last call, which the next call
+    // will not return again; all pages on the first call.
+    std::vector< addr_t > take_checkpoint_pages();
+    // Arms `recovery` on the calling thread until `disarm`: an access past
+    // the end of this memory through the accessors below then returns to
+    // `recovery.env`, which the caller sets with `sigsetjmp( env, 0 )` right
+    // after arming. Unarmed, such an access throws `std::out_of_range` or,
+    // with `MEM_GUARD`, is a plain segmentation fault.
+    void arm( recovery_t &recovery ) const;
+    static void disarm( recovery_t &recovery );
+    // whether `[addr, addr + size)` is within the memory
+    bool is_in_bounds( addr_t addr, addr_t size ) const;
     uint8_t  lb( addr_t addr ) const;
     uint16_t lh( addr_t addr ) const;
     uint32_t lw( addr_t addr ) const;
@@ -53,6 +164,11 @@ public:
     void sh( addr_t addr, uint16_t word16 );
     void sw( addr_t addr, uint32_t word32 );
     void sd( addr_t addr, uint64_t word64 );  // rv64i
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    void map_elf( int fd );
 };  // END class Memory
 
 }  // END namespace cpu_emu::memory
@@ -0,0 +1,288 @@
+// pipeline timing model
+
+
+
+// INCLUDES
+
+#include "pipeline.hpp"
+
+#include "cache.hpp"
+#include "isa.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::pipeline;
+using namespace cpu_emu::isa;
+using cpu_emu::cache::level_e;
+
+
+
+// STRUCT DEFINITIONS
+
+struct mnem_info_t
+{
+    opcode_type_e type;
+    bool reads_rs1;
+    bool reads_rs2;
+    bool load;
+};  // END struct mnem_info_t
+
+
+
+// CONSTEXPR DEFINITIONS
+
+constexpr addr_t iword_size = iword_length >> 3;
+
+// by `opcode_type_e`
+constexpr const char *opcode_type_str_arr[ opcode_type_count ] =
+        { "reg", "imm", "store", "branch", "upper", "jump" };
+
+
+
+// CONSTEXPR FUNCTION DEFINITIONS
+
+// Returns the format type and the source registers of each mnem; the bit
+// fields of the others are not registers, or are unused.
+constexpr
+std::array< mnem_info_t, mnem_count >
+make_mnem_info_arr()
+{
+    std::array< mnem_info_t, mnem_count > info_arr{};
+    for ( auto &info : info_arr ) {
+        info = { opcode_type_e::_illegal, false, false, false };
+    }
+
+    for ( const auto &encoding : encoding_arr ) {
+        const auto mnem = encoding.mnem;
+        const auto type = opcode_type( opcode_e{ encoding.match & 0x7f } );
+        const bool no_rs1 =
+                type == opcode_type_e::upper || type == opcode_type_e::jump
+             || (mnem >= mnem_e::FENCE && mnem <= mnem_e::FENCE_I)
+             || (mnem >= mnem_e::ECALL && mnem <= mnem_e::EBREAK)
+             || (mnem >= mnem_e::CSRRWI && mnem <= mnem_e::CSRRCI);
+
+        info_arr[ static_cast< std::size_t >( mnem ) ] = {
+            type,
+            !no_rs1,
+            type == opcode_type_e::reg || type == opcode_type_e::store
+         || type == opcode_type_e::branch,
+            mnem >= mnem_e::LB && mnem <= mnem_e::LHU,
+        };
+    }
+
+    return info_arr;
+}
+
+constexpr auto mnem_info_arr = make_mnem_info_arr();
+
+
+
+// FUNCTION DEFINITIONS
+
+std::uint32_t
+parse_cycles(
+    const std::string &str
+)
+{
+    std::size_t pos = 0;
+    const auto cycles = std::stoul( str, &pos, 0 );
+    if ( pos != str.size() || cycles > UINT32_MAX ) {
+        throw std::invalid_argument( "Malformed cycles: '" + str + "'." );
+    }
+
+    return static_cast< std::uint32_t >( cycles );
+}
+
+}  // END namespace
+
+
+
+namespace cpu_emu::pipeline {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Model::Model(
+    const timing_config_t &config
+):
+    config( config )
+{
+    for ( const auto latency : config.latency_arr ) {
+        if ( !latency ) {
+            throw std::invalid_argument( "Malformed timing configuration." );
+        }
+    }
+}
+
+Model::~Model()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+void
+Model::retire(
+    addr_t pc,
+    const isa::cinstr_t &instr,
+    addr_t next_pc,
+    const observation_t &observation
+)
+{
+    const auto &config = this->config;
+    const auto &info   =
+            mnem_info_arr[ static_cast< std::size_t >( instr.mnem ) ];
+    const auto  level_cycles = [ &config ]( level_e level ) -> std::uint64_t
+    {
+        switch ( level ) {
+            case level_e::l1:   return 0;
+            case level_e::l2:   return config.l2;
+            case level_e::mem:  return config.l2 + config.mem;
+        }
+
+        return 0;
+    };
+
+    ++this->retired_count;
+    if ( info.type == opcode_type_e::_illegal ) { return; }  // never retires
+
+    this->execute_stall_count +=
+            config.latency_arr[ static_cast< std::size_t >( info.type ) ] - 1;
+
+    // forwarded from the memory stage, a cycle too late for execute
+    if (
+        this->load_rd
+     && (   (info.reads_rs1 && instr.rs1 == this->load_rd)
+         || (info.reads_rs2 && instr.rs2 == this->load_rd))
+    ) {
+        this->load_use_stall_count += config.load_use;
+    }
+    this->load_rd = info.load ? instr.rd : 0;
+
+    if ( observation.predicted ) {
+        if ( observation.mispredicted ) {
+            this->control_stall_count += config.mispredict;
+        }
+    }
+    else if ( info.type == opcode_type_e::jump ) {
+        this->control_stall_count += config.redirect;
+    }
+    else if (
+        instr.mnem == mnem_e::JALR
+     || (info.type == opcode_type_e::branch && next_pc != pc + iword_size)
+    ) {
+        this->control_stall_count += config.mispredict;
+    }
+
+    this->fetch_stall_count += level_cycles( observation.fetch_level );
+    this->data_stall_count  += level_cycles( observation.data_level );
+}
+
+std::uint64_t
+Model::get_cycle_count() const
+{
+    if ( !this->retired_count ) { return 0; }
+
+    return this->retired_count + (stage_count - 1)
+         + this->execute_stall_count + this->load_use_stall_count
+         + this->control_stall_count
+         + this->fetch_stall_count + this->data_stall_count;
+}
+
+std::uint64_t
+Model::get_retired_count() const
+{
+    return this->retired_count;
+}
+
+void
+Model::report(
+    std::ostream &os
+) const
+{
+    const auto flags     = os.flags();
+    const auto precision = os.precision();
+    os << std::fixed << std::setprecision( 3 );
+
+    const auto cycle_count = this->get_cycle_count();
+    const auto cpi = [ this ]( std::uint64_t cycles )
+    {
+        return this->retired_count
+             ? static_cast< double >( cycles ) / this->retired_count
+             : 0.0;
+    };
+    const auto stall = [ &os, &cpi ]( const char *name, std::uint64_t cycles )
+    {
+        os << "pipeline: stall: " << name << ", cycles: " << cycles
+           << ", cpi: " << cpi( cycles ) << std::endl;
+    };
+
+    os << "pipeline: cycles: " << cycle_count
+       << ", instructions: " << this->retired_count
+       << ", cpi: " << cpi( cycle_count ) << std::endl;
+    stall( "execute", this->execute_stall_count );
+    stall( "load_use", this->load_use_stall_count );
+    stall( "control", this->control_stall_count );
+    stall( "fetch", this->fetch_stall_count );
+    stall( "data", this->data_stall_count );
+
+    os.flags( flags );
+    os.precision( precision );
+}
+
+
+
+// FUNCTION DEFINITIONS
+
+timing_config_t
+parse_timing_config(
+    const std::string &spec
+)
+{
+    timing_config_t config;
+    if ( spec == "default" ) { return config; }
+
+    std::istringstream spec_ss( spec );
+    for ( std::string field;  std::getline( spec_ss, field, ',' ); ) {
+        const auto pos = field.find( '=' );
+        if ( pos == std::string::npos ) {
+            throw std::invalid_argument(
+                    "Malformed timing field: '" + field + "'." );
+        }
+        const auto key    = field.substr( 0, pos );
+        const auto cycles = parse_cycles( field.substr( pos + 1 ) );
+
+        std::uint32_t *value = nullptr;
+        for ( std::size_t i_ = 0;  i_ < opcode_type_count;  ++i_ ) {
+            if ( key == opcode_type_str_arr[ i_ ] ) {
+                value = &config.latency_arr[ i_ ];
+            }
+        }
+        if      ( key == "load_use"   ) { value = &config.load_use;   }
+        else if ( key == "mispredict" ) { value = &config.mispredict; }
+        else if ( key == "redirect"   ) { value = &config.redirect;   }
+        else if ( key == "l2"         ) { value = &config.l2;         }
+        else if ( key == "mem"        ) { value = &config.mem;        }
+        if ( !value ) {
+            throw std::invalid_argument( "Unknown timing key: '" + key + "'." );
+        }
+        *value = cycles;
+    }
+
+    return config;
+}
+
+}  // END namespace cpu_emu::pipeline
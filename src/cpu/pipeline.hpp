@@ -0,0 +1,110 @@
+#pragma once
+
+// pipeline timing model
+
+
+
+// INCLUDES
+
+#include "cache.hpp"
+#include "isa.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+
+namespace cpu_emu::pipeline {
+
+// CONSTEXPR DEFINITIONS
+
+constexpr std::size_t stage_count = 5;  // fetch, decode, execute, memory, wb
+constexpr std::size_t opcode_type_count =
+        static_cast< std::size_t >( isa::opcode_type_e::_illegal );
+
+
+
+// STRUCT DEFINITIONS
+
+// All in cycles.
+struct timing_config_t
+{
+    // in the execute stage, by `opcode_type_e`; over 1 stalls the next
+    std::array< std::uint32_t, opcode_type_count > latency_arr =
+            { 1, 1, 1, 1, 1, 1 };
+    std::uint32_t load_use   = 1;    // a load's result used by the next
+    std::uint32_t mispredict = 2;    // a transfer resolved in execute
+    std::uint32_t redirect   = 1;    // a `jal` resolved in decode
+    std::uint32_t l2         = 10;   // an L1 miss served by the L2
+    std::uint32_t mem        = 100;  // an L2 miss, besides `l2`
+};  // END struct timing_config_t
+
+// What the other models observed of one retired instruction.
+struct observation_t
+{
+    cache::level_e fetch_level = cache::level_e::l1;  // without a cache model
+    cache::level_e data_level  = cache::level_e::l1;  // also without an access
+    bool predicted    = false;  // whether a branch model judged the transfer
+    bool mispredicted = false;
+};  // END struct observation_t
+
+
+
+// CLASS DEFINITIONS
+
+// A classic 5-stage in-order pipeline with full forwarding, timed from the
+// retired instruction stream: one instruction enters per cycle, except for
+// stalls on execute latencies, load-use hazards, cache misses, and control
+// transfers. Without a branch model, fetch predicts not taken; with one, its
+// mispredictions cost the same as a taken branch otherwise would.
+class Model final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    using addr_t = isa::addr_t;
+
+
+// DATA MEMBERS
+private:
+    timing_config_t config;
+    std::uint8_t  load_rd = 0;  // of the previous instruction, if a load
+    std::uint64_t retired_count       = 0;
+    std::uint64_t execute_stall_count = 0;  // in cycles; likewise below
+    std::uint64_t load_use_stall_count = 0;
+    std::uint64_t control_stall_count = 0;
+    std::uint64_t fetch_stall_count   = 0;
+    std::uint64_t data_stall_count    = 0;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    explicit Model( const timing_config_t &config );
+    ~Model();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    // `next_pc` follows the instruction at `pc`.
+    void retire( addr_t pc, const isa::cinstr_t &instr, addr_t next_pc,
+                 const observation_t &observation );
+    std::uint64_t get_cycle_count() const;  // incl. filling the pipeline
+    std::uint64_t get_retired_count() const;
+    // cycles, cpi, and the stalls by cause
+    void report( std::ostream &os ) const;
+};  // END class Model
+
+
+
+// FUNCTION DECLARATIONS
+
+// Parses comma-separated `<key>=<cycles>` overrides of the default
+// configuration; e.g., `load_use=2,mem=200`. `<key>` is an opcode format type
+// (`reg`, `imm`, `store`, `branch`, `upper`, `jump`) for its execute latency,
+// or a field of `timing_config_t`. `default` parses to the default
+// configuration. Throws on malformed specifications.
+timing_config_t parse_timing_config( const std::string &spec );
+
+}  // END namespace cpu_emu::pipeline
@@ -0,0 +1,225 @@
+// profiler
+
+
+
+// INCLUDES
+
+#include "profiler.hpp"
+
+#include "decoder.hpp"
+#include "isa.hpp"
+#include "memory.hpp"
+#include "report.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+
+}  // END namespace
+
+
+
+namespace cpu_emu::cpu {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Profiler::Profiler()
+{}
+
+Profiler::~Profiler()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+Profiler::block_t &
+Profiler::get_block(
+    addr_t pc,
+    addr_t end_pc
+)
+{
+    const auto key = std::uint64_t( end_pc ) << addr_length | pc;
+
+    auto it = this->block_map.find( key );
+    if ( it == this->block_map.end() ) {
+        it = this->block_map.emplace( key, block_t{ pc, end_pc, 0, 0 } ).first;
+        this->entry_map.emplace( pc, &it->second );
+    }
+
+    return it->second;
+}
+
+Profiler::block_t *
+Profiler::find_block(
+    addr_t pc
+)
+{
+    const auto it = this->entry_map.find( pc );
+
+    return it != this->entry_map.end() ? it->second : nullptr;
+}
+
+void
+Profiler::truncate(
+    block_t &block,
+    addr_t end_pc
+)
+{
+    --block.count;
+    if ( end_pc != block.pc ) { ++this->get_block( block.pc, end_pc ).count; }
+}
+
+const std::unordered_map< std::uint64_t, Profiler::block_t > &
+Profiler::get_block_map() const
+{
+    return this->block_map;
+}
+
+void
+Profiler::clear()
+{
+    this->block_map.clear();
+    this->entry_map.clear();
+}
+
+void
+Profiler::report(
+    std::ostream &os,
+    const memory::Memory &mem,
+    std::size_t top_count
+) const
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    // per-pc counts; a block's jumps are taken by its last instruction
+    struct pc_profile_t
+    {
+        addr_t        pc;
+        std::uint64_t count;
+        std::uint64_t jump_count;
+    };
+    std::unordered_map< addr_t, pc_profile_t > pc_map;
+    std::vector< std::pair< std::uint64_t, const block_t * > > block_vec;
+    std::uint64_t step_count = 0;
+    for ( const auto &pair : this->block_map ) {
+        const auto &block = pair.second;
+        if ( !block.count ) { continue; }  // only ever left early
+        const std::uint64_t block_steps =
+                block.count * ((block.end_pc - block.pc) / iword_size);
+
+        for (
+            addr_t pc_ = block.pc;
+            pc_ != block.end_pc;
+            pc_ += iword_size
+        ) {
+            auto &pc_profile = pc_map.try_emplace(
+                    pc_, pc_profile_t{ pc_, 0, 0 } ).first->second;
+            pc_profile.count += block.count;
+            if ( pc_ + iword_size == block.end_pc ) {
+                pc_profile.jump_count += block.jump_count;
+            }
+        }
+        block_vec.emplace_back( block_steps, &block );
+        step_count += block_steps;
+    }
+
+    std::vector< pc_profile_t > pc_vec;
+    std::vector< pc_profile_t > branch_vec;
+    for ( const auto &pair : pc_map ) {
+        const auto &pc_profile = pair.second;
+
+        pc_vec.push_back( pc_profile );
+        // a block may end at a pc whose fetch faulted
+        if ( !mem.is_in_bounds( pc_profile.pc, iword_size ) ) { continue; }
+        const auto mnem =
+                decoder::decode_compact( mem.lw( pc_profile.pc ) ).mnem;
+        if ( mnem >= mnem_e::BEQ && mnem <= mnem_e::BGEU ) {
+            branch_vec.push_back( pc_profile );
+        }
+    }
+
+    // hottest first; ties by address, for a stable report
+    std::sort( block_vec.begin(), block_vec.end(),
+            []( const auto &lhs, const auto &rhs )
+            {
+                return lhs.first != rhs.first ? lhs.first > rhs.first
+                                              : lhs.second->pc < rhs.second->pc;
+            } );
+    const auto by_count = []( const auto &lhs, const auto &rhs )
+    {
+        return lhs.count != rhs.count ? lhs.count > rhs.count
+                                      : lhs.pc < rhs.pc;
+    };
+    std::sort( pc_vec.begin(), pc_vec.end(), by_count );
+    std::sort( branch_vec.begin(), branch_vec.end(), by_count );
+
+    const auto flags     = os.flags();
+    const auto precision = os.precision();
+    os << std::fixed << std::setprecision( 1 );
+
+    const auto addr = [ &os ]( addr_t addr_ ) -> std::ostream &
+    {
+        return os << std::hex << std::showbase << addr_
+                  << std::dec << std::noshowbase;
+    };
+    const auto share = [ &os, step_count ]( std::uint64_t steps )
+    {
+        os << ", share: "
+           << 100.0 * steps / std::max< std::uint64_t >( step_count, 1 ) << "%";
+    };
+
+    os << "profile: step_count: " << step_count
+       << ", block_count: " << block_vec.size() << std::endl;
+
+    block_vec.resize( std::min( top_count, block_vec.size() ) );
+    pc_vec.resize( std::min( top_count, pc_vec.size() ) );
+    branch_vec.resize( std::min( top_count, branch_vec.size() ) );
+
+    for ( const auto &[ block_steps, block ] : block_vec ) {
+        os << "profile: block: ";
+        addr( block->pc ) << "-";
+        addr( block->end_pc ) << ", count: " << block->count
+                              << ", jumps: " << block->jump_count;
+        share( block_steps );
+        report::print_symbol( os, mem, block->pc );
+        os << std::endl;
+    }
+
+    for ( const auto &pc_profile : pc_vec ) {
+        os << "profile: pc: ";
+        addr( pc_profile.pc ) << ", count: " << pc_profile.count;
+        share( pc_profile.count );
+        report::print_pc( os, mem, pc_profile.pc );
+        os << std::endl;
+    }
+
+    for ( const auto &pc_profile : branch_vec ) {
+        const auto taken = pc_profile.jump_count;
+
+        os << "profile: branch: ";
+        addr( pc_profile.pc ) << ", taken: " << taken
+                              << ", not_taken: " << pc_profile.count - taken;
+        report::print_pc( os, mem, pc_profile.pc );
+        os << std::endl;
+    }
+
+    os.flags( flags );
+    os.precision( precision );
+}
+
+}  // END namespace cpu_emu::cpu
@@ -0,0 +1,68 @@
+#pragma once
+
+// profiler
+
+
+
+// INCLUDES
+
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+
+
+namespace cpu_emu::cpu {
+
+// CLASS DEFINITIONS
+
+// Counts the executions of guest blocks, as delimited by the engine running
+// them; per-pc and per-branch counts are derived from these for the report.
+// A block left early (e.g., by a fault or at the end of the run) is counted
+// as the part run instead; see `truncate`.
+class Profiler final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    using addr_t = isa::addr_t;
+
+    struct block_t
+    {
+        addr_t        pc;          // address of the first instruction
+        addr_t        end_pc;      // address past the last instruction
+        std::uint64_t count;       // entries
+        std::uint64_t jump_count;  // exits elsewhere than to `end_pc`
+    };  // END struct block_t
+
+
+// DATA MEMBERS
+private:
+    // by `end_pc << 32 | pc`; element references stay valid on insertion
+    std::unordered_map< std::uint64_t, block_t > block_map;
+    std::unordered_map< addr_t, block_t * > entry_map;  // first block per pc
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Profiler();
+    ~Profiler();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    block_t &get_block( addr_t pc, addr_t end_pc );
+    block_t *find_block( addr_t pc );  // any block at `pc`; or `nullptr`
+    // moves an entry of `block` to its part `[pc, end_pc)`, if not empty
+    void truncate( block_t &block, addr_t end_pc );
+    const std::unordered_map< std::uint64_t, block_t > &get_block_map() const;
+    void clear();
+    // hot blocks, pcs, and branches; at most `top_count` of each
+    void report( std::ostream &os, const memory::Memory &mem,
+                 std::size_t top_count ) const;
+};  // END class Profiler
+
+}  // END namespace cpu_emu::cpu
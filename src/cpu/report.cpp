@@ -0,0 +1,61 @@
+// report annotations
+
+
+
+// INCLUDES
+
+#include "report.hpp"
+
+#include "decoder.hpp"
+#include "elf.hpp"
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <ios>
+#include <ostream>
+
+
+
+namespace cpu_emu::report {
+
+// FUNCTION DEFINITIONS
+
+void
+print_pc(
+    std::ostream &os,
+    const memory::Memory &mem,
+    isa::addr_t pc
+)
+{
+    constexpr isa::addr_t iword_size = isa::iword_length >> 3;
+
+    os << ", mnem: ";
+    if ( mem.is_in_bounds( pc, iword_size ) ) {
+        os << isa::mnem_str(
+                cpu::decoder::decode_compact( mem.lw( pc ) ).mnem );
+    }
+    else {
+        os << "-";  // e.g., a block ending where the fetch faulted
+    }
+    print_symbol( os, mem, pc );
+}
+
+void
+print_symbol(
+    std::ostream &os,
+    const memory::Memory &mem,
+    isa::addr_t pc
+)
+{
+    const auto &elf = mem.get_elf();
+    if ( !elf ) { return; }
+
+    if ( const auto *symbol = elf->find_symbol( pc ) ) {
+        const auto flags = os.flags();
+        os << ", symbol: " << symbol->name << "+"
+           << std::hex << std::showbase << pc - symbol->addr;
+        os.flags( flags );
+    }
+}
+
+}  // END namespace cpu_emu::report
@@ -0,0 +1,52 @@
+#pragma once
+
+// report annotations
+
+
+
+// INCLUDES
+
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+
+
+namespace cpu_emu::report {
+
+// FUNCTION DECLARATIONS
+
+// Prints `, mnem: <mnem>` for the instruction at `pc`, or `-` if it cannot
+// be fetched, followed by `print_symbol`.
+void print_pc( std::ostream &os, const memory::Memory &mem, isa::addr_t pc );
+// Prints `, symbol: <name>+<offset>` if an ELF symbol contains `pc`.
+void print_symbol( std::ostream &os, const memory::Memory &mem,
+                   isa::addr_t pc );
+
+
+
+// FUNCTION-TEMPLATE DEFINITIONS
+
+// Sorts the ascending `pc_vec` by `key( pc )`, largest first, and keeps the
+// first `top_count`; ties stay by address, for a stable report.
+template< typename T_key >
+void
+keep_top(
+    std::vector< isa::addr_t > &pc_vec,
+    std::size_t top_count,
+    T_key key
+)
+{
+    std::stable_sort( pc_vec.begin(), pc_vec.end(),
+            [ &key ]( isa::addr_t lhs, isa::addr_t rhs )
+            {
+                return key( lhs ) > key( rhs );
+            } );
+    pc_vec.resize( std::min( top_count, pc_vec.size() ) );
+}
+
+}  // END namespace cpu_emu::report
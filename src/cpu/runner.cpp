@@ -0,0 +1,155 @@
+// multi-instance runner
+
+
+
+// INCLUDES
+
+#include "runner.hpp"
+
+#include "console.hpp"
+#include "cpu.hpp"
+#include "memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>  // pthread_setaffinity_np
+#include <sched.h>    // cpu_set_t
+
+
+
+namespace cpu_emu::cpu {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Runner::Runner(
+    const memory::Image &image,
+    const runner_config_t &config
+):
+    image( image ),
+    config( config )
+{}
+
+Runner::~Runner()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+batch_result_t
+Runner::run(
+    const std::vector< std::string > &input_vec
+) const
+{
+    const std::size_t hw_count =
+            std::max( std::thread::hardware_concurrency(), 1u );
+
+    batch_result_t result;
+    result.instance_vec.resize( input_vec.size() );
+    result.thread_count = std::min(
+        this->config.thread_count ? this->config.thread_count : hw_count,
+        std::max< std::size_t >( input_vec.size(), 1 )
+    );
+
+    // workers take the next unstarted instance until none are left
+    std::atomic< std::size_t > next_index( 0 );
+    const auto work = [ & ]( std::size_t worker_index )
+    {
+        if ( this->config.affinity ) { pin_thread( worker_index % hw_count ); }
+
+        for (
+            std::size_t i_ = next_index++;
+            i_ < input_vec.size();
+            i_ = next_index++
+        ) {
+            result.instance_vec[ i_ ] = this->run_instance( input_vec[ i_ ] );
+        }
+    };
+
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector< std::thread > thread_vec;
+    for ( std::size_t i_ = 0;  i_ < result.thread_count;  ++i_ ) {
+        thread_vec.emplace_back( work, i_ );
+    }
+    for ( auto &thread : thread_vec ) {
+        thread.join();
+    }
+    const std::chrono::duration< double > elapsed =
+            std::chrono::steady_clock::now() - start_time;
+
+    result.elapsed_s  = elapsed.count();
+    result.step_count = 0;
+    for ( const auto &instance : result.instance_vec ) {
+        result.step_count += instance.run_result.step_count;
+    }
+
+    return result;
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+instance_result_t
+Runner::run_instance(
+    const std::string &input
+) const
+{
+    instance_result_t result{};
+
+    const auto start_time = std::chrono::steady_clock::now();
+    try {
+        Cpu cpu( this->image, this->config.pc_reg, this->config.sp_reg );
+        cpu.set_engine( this->config.engine );
+        cpu.set_console( console::Console( input ) );
+
+        try {
+            result.run_result = cpu.run(
+                this->config.max_steps,
+                this->config.stop_conditions
+            );
+        }
+        catch ( const std::exception &exception ) {
+            // a host error, e.g., a failed write of the guest output; guest
+            // faults are traps, which return normally
+            result.run_result.step_count = cpu.get_step_count();
+            result.run_result.pc         = cpu.get_pc_reg();
+            result.run_result.stop       = stop_e::none;
+            result.fault                 = exception.what();
+        }
+
+        result.out_str = cpu.get_console().get_out_str();
+        result.err_str = cpu.get_console().get_err_str();
+    }
+    catch ( const std::exception &exception ) {
+        result.fault = exception.what();  // e.g., the image could not be mapped
+    }
+    const std::chrono::duration< double > elapsed =
+            std::chrono::steady_clock::now() - start_time;
+
+    result.elapsed_s = elapsed.count();
+
+    return result;
+}
+
+void
+Runner::pin_thread(
+    std::size_t cpu_index
+)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO( &cpu_set );
+    CPU_SET( cpu_index, &cpu_set );
+
+    // best effort; e.g., the cpu may be outside the allowed set
+    pthread_setaffinity_np( pthread_self(), sizeof( cpu_set ), &cpu_set );
+}
+
+}  // END namespace cpu_emu::cpu
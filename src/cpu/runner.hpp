@@ -0,0 +1,85 @@
+#pragma once
+
+// multi-instance runner
+
+
+
+// INCLUDES
+
+#include "cpu.hpp"
+#include "defines.h"
+#include "isa.hpp"
+#include "memory.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+
+namespace cpu_emu::cpu {
+
+// STRUCT DEFINITIONS
+
+struct runner_config_t
+{
+    engine_e          engine       = engine_e::interp;
+    std::size_t       thread_count = 0;      // 0: one per hardware thread
+    bool              affinity     = false;  // pin worker i to cpu i
+    std::size_t       max_steps    = -1;     // per instance
+    stop_conditions_t stop_conditions;
+    isa::word_t       pc_reg       = ENTRY_POINT_ADDR;
+    isa::word_t       sp_reg       = STACK_START_ADDR;
+};  // END struct runner_config_t
+
+struct instance_result_t
+{
+    run_result_t run_result;
+    double       elapsed_s;
+    std::string  out_str;  // guest standard output
+    std::string  err_str;  // guest standard error
+    std::string  fault;    // what the run threw, if anything
+};  // END struct instance_result_t
+
+struct batch_result_t
+{
+    std::vector< instance_result_t > instance_vec;  // in input order
+    std::size_t thread_count;
+    std::size_t step_count;  // sum over instances
+    double      elapsed_s;   // wall time of the whole batch
+};  // END struct batch_result_t
+
+
+
+// CLASS DEFINITIONS
+
+// Runs independent guest instances on a pool of worker threads.
+// Every instance gets its own `Cpu` with a copy-on-write overlay of the
+// shared image, and its own console streams fed from its input.
+class Runner final
+{
+// DATA MEMBERS
+private:
+    const memory::Image &image;
+    const runner_config_t config;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Runner( const memory::Image &image, const runner_config_t &config );
+    ~Runner();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    // runs one instance per input; thread-safe
+    batch_result_t run( const std::vector< std::string > &input_vec ) const;
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    instance_result_t run_instance( const std::string &input ) const;
+    static void pin_thread( std::size_t cpu_index );
+};  // END class Runner
+
+}  // END namespace cpu_emu::cpu
@@ -0,0 +1,547 @@
+// sampled simulation driver
+
+
+
+// INCLUDES
+
+#include "console.hpp"
+#include "cpu.hpp"
+#include "defines.h"
+#include "memory.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>  // getopt
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::console;
+using namespace cpu_emu::cpu;
+using namespace cpu_emu::memory;
+
+
+
+// CONSTEXPR DEFINITIONS
+
+constexpr std::size_t dim_count      = 15;   // of the projected BBVs
+constexpr std::size_t seed_count     = 5;    // k-means restarts; best kept
+constexpr std::size_t max_iter_count = 100;  // per k-means run
+
+
+
+// TYPE DEFINITIONS
+
+using point_t = std::array< double, dim_count >;
+
+
+
+// STRUCT DEFINITIONS
+
+struct interval_t
+{
+    std::size_t   start_step;
+    std::size_t   step_count;
+    std::uint64_t jump_count;  // control transfers; the estimated metric
+    point_t       bbv;  // basic-block vector; normalized, then projected
+};  // END struct interval_t
+
+struct simpoint_t
+{
+    std::size_t interval_index;  // the interval closest to its centroid
+    std::size_t step_count;      // of every interval in the cluster
+    std::string checkpoint_path;
+    std::size_t in_pos;  // guest input consumed before the interval
+};  // END struct simpoint_t
+
+struct detail_t
+{
+    std::size_t   step_count;
+    std::uint64_t jump_count;
+    double        elapsed_s;
+    std::string   fault;  // what the run threw, if anything
+};  // END struct detail_t
+
+}  // END namespace
+
+
+
+// STATIC FUNCTION DEFINITIONS
+
+// splitmix64; a deterministic generator that accepts any state
+static
+std::uint64_t
+next_random(
+    std::uint64_t &state
+)
+{
+    std::uint64_t z = state += 0x9e3779b97f4a7c15;
+    z = (z ^ z >> 30) * 0xbf58476d1ce4e5b9;
+    z = (z ^ z >> 27) * 0x94d049bb133111eb;
+
+    return z ^ z >> 31;
+}
+
+// Returns the projection of a block's dimension onto the BBV dimensions;
+// a fixed pseudo-random vector in [-1, 1) per block, as in SimPoint.
+static
+point_t
+project(
+    std::uint64_t block_key
+)
+{
+    point_t point;
+    for ( auto &coord : point ) {
+        coord = double( next_random( block_key ) >> 11 ) / (1ull << 52) - 1;
+    }
+
+    return point;
+}
+
+static
+double
+distance2(
+    const point_t &lhs,
+    const point_t &rhs
+)
+{
+    double sum = 0;
+    for ( std::size_t i_ = 0;  i_ < dim_count;  ++i_ ) {
+        sum += (lhs[ i_ ] - rhs[ i_ ]) * (lhs[ i_ ] - rhs[ i_ ]);
+    }
+
+    return sum;
+}
+
+// Runs the program in intervals of `interval_length` steps with profiling,
+// taking each interval's BBV from the differences of the block counts.
+static
+std::vector< interval_t >
+collect_intervals(
+    Cpu &cpu,
+    std::size_t interval_length
+)
+{
+    struct count_t
+    {
+        std::uint64_t count;
+        std::uint64_t jump_count;
+    };
+    std::unordered_map< std::uint64_t, count_t > prev_map;
+    std::unordered_map< std::uint64_t, point_t > projection_map;
+    std::vector< interval_t > interval_vec;
+
+    cpu.set_profiling( true );
+    const auto &block_map = cpu.get_profiler()->get_block_map();
+    for ( bool running_ = true;  running_; ) {
+        const std::size_t start_step = cpu.get_step_count();
+        const auto result = cpu.run( interval_length );
+        running_ = result.stop == stop_e::step_count;
+        if ( !result.step_count ) { break; }
+
+        interval_t interval{ start_step, result.step_count, 0, {} };
+        std::uint64_t weight_sum = 0;
+        std::vector< std::pair< std::uint64_t, std::uint64_t > > weight_vec;
+        for ( const auto &[ key, block ] : block_map ) {
+            auto &prev = prev_map[ key ];
+            const std::uint64_t weight = (block.count - prev.count)
+                                       * ((block.end_pc - block.pc)
+                                        / (cpu_emu::isa::iword_length >> 3));
+
+            if ( weight ) { weight_vec.emplace_back( key, weight ); }
+            weight_sum          += weight;
+            interval.jump_count += block.jump_count - prev.jump_count;
+            prev = { block.count, block.jump_count };
+        }
+        for ( const auto &[ key, weight ] : weight_vec ) {
+            auto it = projection_map.find( key );
+            if ( it == projection_map.end() ) {
+                it = projection_map.emplace( key, project( key ) ).first;
+            }
+            for ( std::size_t i_ = 0;  i_ < dim_count;  ++i_ ) {
+                interval.bbv[ i_ ] += it->second[ i_ ] * weight / weight_sum;
+            }
+        }
+
+        interval_vec.push_back( interval );
+    }
+
+    return interval_vec;
+}
+
+// k-means with k-means++ seeding; returns the cluster of each point and
+// the sum of the squared distances to the centroids.
+static
+std::pair< std::vector< std::size_t >, double >
+cluster(
+    const std::vector< interval_t > &interval_vec,
+    std::size_t cluster_count,
+    std::uint64_t seed
+)
+{
+    const std::size_t count = interval_vec.size();
+    const auto random_unit = [ &seed ]
+    {
+        return double( next_random( seed ) >> 11 ) / (1ull << 53);
+    };
+
+    std::vector< point_t > centroid_vec{
+            interval_vec[ next_random( seed ) % count ].bbv };
+    std::vector< double > nearest_vec( count );
+    while ( centroid_vec.size() < cluster_count ) {
+        double sum = 0;
+        for ( std::size_t i_ = 0;  i_ < count;  ++i_ ) {
+            nearest_vec[ i_ ] = std::numeric_limits< double >::max();
+            for ( const auto &centroid : centroid_vec ) {
+                nearest_vec[ i_ ] = std::min(
+                        nearest_vec[ i_ ],
+                        distance2( interval_vec[ i_ ].bbv, centroid ) );
+            }
+            sum += nearest_vec[ i_ ];
+        }
+
+        // farther points are likelier; identical points are never taken
+        double pick = random_unit() * sum;
+        std::size_t i_ = 0;
+        for ( ;  i_ + 1 < count && pick >= nearest_vec[ i_ ];  ++i_ ) {
+            pick -= nearest_vec[ i_ ];
+        }
+        centroid_vec.push_back( interval_vec[ i_ ].bbv );
+    }
+
+    std::vector< std::size_t > cluster_vec( count, 0 );
+    double sse = 0;
+    for ( std::size_t iter_ = 0;  iter_ < max_iter_count;  ++iter_ ) {
+        bool changed = false;
+        sse = 0;
+        for ( std::size_t i_ = 0;  i_ < count;  ++i_ ) {
+            double best = std::numeric_limits< double >::max();
+            std::size_t best_cluster = 0;
+            for ( std::size_t c_ = 0;  c_ < cluster_count;  ++c_ ) {
+                const double d2 =
+                        distance2( interval_vec[ i_ ].bbv, centroid_vec[ c_ ] );
+                if ( d2 < best ) {
+                    best = d2;
+                    best_cluster = c_;
+                }
+            }
+            changed = changed || cluster_vec[ i_ ] != best_cluster;
+            cluster_vec[ i_ ] = best_cluster;
+            sse += best;
+        }
+        if ( iter_ && !changed ) { break; }
+
+        std::vector< point_t > sum_vec( cluster_count, point_t{} );
+        std::vector< std::size_t > size_vec( cluster_count, 0 );
+        for ( std::size_t i_ = 0;  i_ < count;  ++i_ ) {
+            for ( std::size_t d_ = 0;  d_ < dim_count;  ++d_ ) {
+                sum_vec[ cluster_vec[ i_ ] ][ d_ ] +=
+                        interval_vec[ i_ ].bbv[ d_ ];
+            }
+            ++size_vec[ cluster_vec[ i_ ] ];
+        }
+        for ( std::size_t c_ = 0;  c_ < cluster_count;  ++c_ ) {
+            if ( !size_vec[ c_ ] ) { continue; }  // keeps its old centroid
+            for ( std::size_t d_ = 0;  d_ < dim_count;  ++d_ ) {
+                centroid_vec[ c_ ][ d_ ] = sum_vec[ c_ ][ d_ ] / size_vec[ c_ ];
+            }
+        }
+    }
+
+    return { cluster_vec, sse };
+}
+
+// Picks the interval closest to the centroid of each cluster.
+static
+std::vector< simpoint_t >
+choose_simpoints(
+    const std::vector< interval_t > &interval_vec,
+    std::size_t cluster_count
+)
+{
+    cluster_count = std::min( cluster_count, interval_vec.size() );
+
+    std::pair< std::vector< std::size_t >, double > best{ {}, 0 };
+    for ( std::uint64_t seed_ = 0;  seed_ < seed_count;  ++seed_ ) {
+        auto result = cluster( interval_vec, cluster_count, seed_ );
+        if ( best.first.empty() || result.second < best.second ) {
+            best = std::move( result );
+        }
+    }
+    const auto &cluster_vec = best.first;
+
+    std::vector< simpoint_t > simpoint_vec;
+    for ( std::size_t c_ = 0;  c_ < cluster_count;  ++c_ ) {
+        point_t centroid{};
+        std::size_t size = 0;
+        std::size_t step_count = 0;
+        for ( std::size_t i_ = 0;  i_ < interval_vec.size();  ++i_ ) {
+            if ( cluster_vec[ i_ ] != c_ ) { continue; }
+            for ( std::size_t d_ = 0;  d_ < dim_count;  ++d_ ) {
+                centroid[ d_ ] += interval_vec[ i_ ].bbv[ d_ ];
+            }
+            ++size;
+            step_count += interval_vec[ i_ ].step_count;
+        }
+        if ( !size ) { continue; }
+        for ( auto &coord : centroid ) { coord /= size; }
+
+        std::size_t closest = 0;
+        double closest_d2 = std::numeric_limits< double >::max();
+        for ( std::size_t i_ = 0;  i_ < interval_vec.size();  ++i_ ) {
+            if ( cluster_vec[ i_ ] != c_ ) { continue; }
+            const double d2 = distance2( interval_vec[ i_ ].bbv, centroid );
+            if ( d2 < closest_d2 ) {
+                closest    = i_;
+                closest_d2 = d2;
+            }
+        }
+        simpoint_vec.push_back( { closest, step_count, "", 0 } );
+    }
+
+    std::sort( simpoint_vec.begin(), simpoint_vec.end(),
+            []( const auto &lhs, const auto &rhs )
+            {
+                return lhs.interval_index < rhs.interval_index;
+            } );
+
+    return simpoint_vec;
+}
+
+// Runs an interval from its checkpoint on the interpreter, with profiling.
+static
+detail_t
+run_detailed(
+    const Image &image,
+    const simpoint_t &simpoint,
+    std::size_t step_count,
+    const std::string &input
+)
+{
+    detail_t detail{ 0, 0, 0, "" };
+
+    const auto start_time = std::chrono::steady_clock::now();
+    try {
+        Cpu cpu( image );
+        cpu.resume( simpoint.checkpoint_path );
+        cpu.set_console( Console( input.substr(
+                std::min( simpoint.in_pos, input.size() ) ) ) );
+        cpu.set_profiling( true );
+
+        detail.step_count = cpu.run( step_count ).step_count;
+        for ( const auto &pair : cpu.get_profiler()->get_block_map() ) {
+            detail.jump_count += pair.second.jump_count;
+        }
+    }
+    catch ( const std::exception &exception ) {
+        detail.fault = exception.what();
+    }
+    const std::chrono::duration< double > elapsed =
+            std::chrono::steady_clock::now() - start_time;
+
+    detail.elapsed_s = elapsed.count();
+
+    return detail;
+}
+
+
+
+// MAIN FUNCTION
+
+int
+main(
+    int argc,
+    char *argv[]
+)
+{
+    const std::string usage = std::string( "Usage: " ) + argv[ 0 ]
+            + " [-e <engine>] [-l <interval_length>] [-k <cluster_count>]"
+            + " [-t <thread_count>] [-o <checkpoint_prefix>] <program_path>\n"
+            + "  <engine>: for profiling and fast-forwarding; jit by default\n"
+            + "  -l: steps per interval; 1000000 by default\n"
+            + "  -k: at most <cluster_count> simulation points; 8 by default\n"
+            + "  -t: detailed runs in parallel; one per cpu by default\n"
+            + "  -o: checkpoints are written to"
+            + " <checkpoint_prefix>.<interval>.ckp; sample by default\n"
+            + "  <program_path>: memory image or RV32 ELF executable;"
+            + " the runs read all of the standard input";
+
+    engine_e engine = engine_e::jit;
+    std::size_t interval_length = 1000000;
+    std::size_t cluster_count   = 8;
+    std::size_t thread_count    = std::max(
+            std::thread::hardware_concurrency(), 1u );
+    std::string checkpoint_prefix = "sample";
+
+    for ( int opt; (opt = getopt( argc, argv, "e:l:k:t:o:" )) != -1; ) {
+        switch ( opt ) {
+            case 'l':
+                interval_length = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 'k':
+                cluster_count = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 't':
+                thread_count = std::stoull( optarg, nullptr, 0 );
+
+                break;
+            case 'o':
+                checkpoint_prefix = optarg;
+
+                break;
+            case 'e':
+                if ( parse_engine( optarg, engine ) ) { break; }
+                [[fallthrough]];
+            default:
+                std::cout << usage << std::endl;
+
+                return EXIT_FAILURE;
+        }
+    }
+    if (
+        optind != argc - 1 || !interval_length || !cluster_count
+     || !thread_count
+    ) {
+        std::cout << usage << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    const Image image( argv[ optind ] );
+    const auto &elf = image.get_elf();
+    const auto pc_reg = elf ? elf->get_entry() : ENTRY_POINT_ADDR;
+    const std::string input(
+        (std::istreambuf_iterator< char >( std::cin )),
+        std::istreambuf_iterator< char >()
+    );
+
+    // 1. profile every interval
+    auto start_time = std::chrono::steady_clock::now();
+    Cpu profile_cpu( image, pc_reg );
+    profile_cpu.set_engine( engine );
+    profile_cpu.set_console( Console( input ) );
+    const auto interval_vec =
+            collect_intervals( profile_cpu, interval_length );
+    std::chrono::duration< double > elapsed =
+            std::chrono::steady_clock::now() - start_time;
+
+    std::size_t step_count = 0;
+    std::uint64_t jump_count = 0;
+    for ( const auto &interval : interval_vec ) {
+        step_count += interval.step_count;
+        jump_count += interval.jump_count;
+    }
+    std::cout << "sample: profile: interval_count: " << interval_vec.size()
+              << ", interval_length: " << interval_length
+              << ", step_count: " << step_count
+              << ", elapsed_s: " << elapsed.count() << std::endl;
+    if ( interval_vec.empty() ) { return EXIT_FAILURE; }
+
+    // 2. choose the simulation points
+    auto simpoint_vec = choose_simpoints( interval_vec, cluster_count );
+
+    // 3. fast-forward to each, dropping a checkpoint
+    start_time = std::chrono::steady_clock::now();
+    Cpu forward_cpu( image, pc_reg );
+    forward_cpu.set_engine( engine );
+    forward_cpu.set_console( Console( input ) );
+    for ( auto &simpoint : simpoint_vec ) {
+        const auto &interval = interval_vec[ simpoint.interval_index ];
+
+        forward_cpu.run( interval.start_step - forward_cpu.get_step_count() );
+        simpoint.checkpoint_path = checkpoint_prefix + "."
+                                 + std::to_string( simpoint.interval_index )
+                                 + ".ckp";
+        simpoint.in_pos = forward_cpu.get_console().get_in_pos();
+        forward_cpu.checkpoint( simpoint.checkpoint_path );
+    }
+    elapsed = std::chrono::steady_clock::now() - start_time;
+    std::cout << "sample: forward: checkpoint_count: " << simpoint_vec.size()
+              << ", elapsed_s: " << elapsed.count() << std::endl;
+
+    // 4. run the simulation points in detail, in parallel
+    std::vector< detail_t > detail_vec( simpoint_vec.size() );
+    std::atomic< std::size_t > next_index( 0 );
+    const auto work = [ & ]
+    {
+        for (
+            std::size_t i_ = next_index++;
+            i_ < simpoint_vec.size();
+            i_ = next_index++
+        ) {
+            const auto &simpoint = simpoint_vec[ i_ ];
+            detail_vec[ i_ ] = run_detailed(
+                    image, simpoint,
+                    interval_vec[ simpoint.interval_index ].step_count,
+                    input );
+        }
+    };
+    start_time = std::chrono::steady_clock::now();
+    std::vector< std::thread > thread_vec;
+    for (
+        std::size_t i_ = 0;
+        i_ < std::min( thread_count, simpoint_vec.size() );
+        ++i_
+    ) {
+        thread_vec.emplace_back( work );
+    }
+    for ( auto &thread : thread_vec ) {
+        thread.join();
+    }
+    elapsed = std::chrono::steady_clock::now() - start_time;
+
+    // the estimate weighs each point by the steps of its cluster
+    bool failed = false;
+    double estimate = 0;
+    for ( std::size_t i_ = 0;  i_ < simpoint_vec.size();  ++i_ ) {
+        const auto &simpoint = simpoint_vec[ i_ ];
+        const auto &interval = interval_vec[ simpoint.interval_index ];
+        const auto &detail   = detail_vec[ i_ ];
+        const double weight  = double( simpoint.step_count ) / step_count;
+        const double jumps_per_kstep =
+                1e3 * detail.jump_count / std::max< std::size_t >(
+                        detail.step_count, 1 );
+
+        std::cout << "sample: simpoint: interval: " << simpoint.interval_index
+                  << ", start_step: " << interval.start_step
+                  << ", weight: " << weight
+                  << ", step_count: " << detail.step_count
+                  << ", jumps_per_kstep: " << jumps_per_kstep
+                  << ", elapsed_s: " << detail.elapsed_s
+                  << ", checkpoint: " << simpoint.checkpoint_path;
+        if ( !detail.fault.empty() ) {
+            std::cout << ", fault: " << detail.fault;
+        }
+        std::cout << std::endl;
+
+        estimate += weight * jumps_per_kstep;
+        failed = failed || !detail.fault.empty()
+              || detail.step_count != interval.step_count;
+    }
+    std::cout << "sample: estimate: jumps_per_kstep: " << estimate
+              << ", actual: " << 1e3 * jump_count / step_count
+              << ", elapsed_s: " << elapsed.count() << std::endl;
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
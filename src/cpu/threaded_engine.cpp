@@ -0,0 +1,605 @@
+// threaded engine
+
+
+
+// INCLUDES
+
+#include "threaded_engine.hpp"
+
+#include "cpu.hpp"
+#include "decoder.hpp"
+#include "isa.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+
+}  // END namespace
+
+
+
+namespace cpu_emu::cpu {
+
+// TYPE ALIASES
+
+using op_t    = Threaded_engine::op_t;
+using block_t = Threaded_engine::block_t;
+
+
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Threaded_engine::Threaded_engine()
+{}
+
+Threaded_engine::~Threaded_engine()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+void
+Threaded_engine::run(
+    Cpu &cpu,
+    std::size_t step_count
+)
+{
+    Profiler *const profiler = cpu.profiler.get();  // or `nullptr`
+    block_t *prev = nullptr;  // the block just executed, to chain from
+
+    this->code_map.resize( cpu.mem.get_mem_size() );
+
+    for (
+        bool first_ = true;
+        step_count && cpu.stop == stop_e::none;
+        first_ = false
+    ) {
+        if ( !this->invalid_vec.empty() ) {
+            this->drop_invalid();
+            prev = nullptr;
+        }
+
+        auto &block = this->next_block( cpu, prev );
+        prev = nullptr;
+
+        // blocks end at breakpoints, so checking block entries suffices
+        if ( block.breakpoint && !first_ ) {
+            cpu.stop = stop_e::breakpoint;
+
+            break;
+        }
+
+        // untranslatable instruction or too few steps left; interpret
+        if ( !block.length || block.length > step_count ) {
+            if ( profiler ) { cpu.step_profiled(); }
+            else            { cpu.step_unguarded(); }
+            --step_count;
+
+            continue;
+        }
+
+        if ( profiler ) {
+            if ( !block.profile ) {
+                block.profile =
+                        &profiler->get_block( block.pc, block.end_pc );
+            }
+            ++block.profile->count;
+        }
+
+        const std::size_t retired = this->exec_block( cpu, block );
+        step_count -= retired;
+        prev = &block;
+
+        // a store to translated code leaves the block early
+        if ( profiler ) {
+            if ( retired != block.length ) {
+                profiler->truncate( *block.profile,
+                                    block.pc + retired * (iword_length >> 3) );
+            }
+            else if ( cpu.pc_reg != block.end_pc ) {
+                ++block.profile->jump_count;
+            }
+        }
+    }
+}
+
+void
+Threaded_engine::invalidate(
+    addr_t addr,
+    addr_t size
+)
+{
+    // blocks may be executing; dropped before the next is entered
+    if ( this->code_map.is_code( addr, size ) ) {
+        this->code_map.find( addr, size, this->invalid_vec );
+    }
+}
+
+void
+Threaded_engine::drop_invalid()
+{
+    for ( const auto pc : this->invalid_vec ) { this->drop_block( pc ); }
+    this->invalid_vec.clear();
+}
+
+void
+Threaded_engine::recover(
+    Cpu &cpu
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+    if ( !this->active_block ) { return; }
+
+    // the access ops set `pc_reg` first; the trapping step is counted
+    const auto &block = *this->active_block;
+    cpu.step_count += (cpu.pc_reg - block.pc) / iword_size + 1;
+    if ( cpu.profiler ) {
+        cpu.profiler->truncate( *block.profile, cpu.pc_reg + iword_size );
+    }
+    this->active_block = nullptr;
+}
+
+void
+Threaded_engine::clear()
+{
+    this->block_map.clear();
+    this->source_map.clear();
+    this->code_map.clear();
+    this->invalid_vec.clear();
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+block_t &
+Threaded_engine::next_block(
+    Cpu &cpu,
+    block_t *prev
+)
+{
+    const addr_t pc = cpu.pc_reg;
+    if ( !prev ) { return this->find_block( cpu, pc ); }
+
+    // links stay valid; dropped blocks are unlinked from their sources
+    for ( std::size_t i_ = 0;  i_ < prev->target_count;  ++i_ ) {
+        if ( prev->target_arr[ i_ ] != pc ) { continue; }
+
+        auto &link = prev->link_arr[ i_ ];
+        if ( !link ) { link = &this->find_block( cpu, pc ); }
+
+        return *link;
+    }
+
+    return this->find_block( cpu, pc );
+}
+
+block_t &
+Threaded_engine::find_block(
+    Cpu &cpu,
+    addr_t pc
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    auto it = this->block_map.find( pc );
+    if ( it != this->block_map.end() ) { return it->second; }
+
+    auto block = this->translate( cpu, pc );
+    for ( std::size_t i_ = 0;  i_ < block.target_count;  ++i_ ) {
+        this->source_map[ block.target_arr[ i_ ] ].push_back( pc );
+    }
+    // an untranslated block still covers its first instruction
+    this->code_map.add( { pc, std::max( block.end_pc, pc + iword_size ) } );
+
+    return this->block_map.emplace( pc, std::move( block ) ).first->second;
+}
+
+void
+Threaded_engine::drop_block(
+    addr_t pc
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    const auto it = this->block_map.find( pc );
+    if ( it == this->block_map.end() ) { return; }  // already dropped
+    const auto &block = it->second;
+
+    // unlink the sources; they may link again once retranslated
+    if ( const auto source_it = this->source_map.find( pc );
+         source_it != this->source_map.end() ) {
+        for ( const auto source_pc : source_it->second ) {
+            auto &source = this->block_map.at( source_pc );
+            for ( std::size_t i_ = 0;  i_ < source.target_count;  ++i_ ) {
+                if ( source.target_arr[ i_ ] == pc ) {
+                    source.link_arr[ i_ ] = nullptr;
+                }
+            }
+        }
+    }
+    for ( std::size_t i_ = 0;  i_ < block.target_count;  ++i_ ) {
+        auto &source_vec = this->source_map[ block.target_arr[ i_ ] ];
+        source_vec.erase(
+                std::remove( source_vec.begin(), source_vec.end(), pc ),
+                source_vec.end() );
+    }
+
+    this->code_map.remove(
+            { pc, std::max( block.end_pc, pc + iword_size ) } );
+    this->block_map.erase( it );
+}
+
+block_t
+Threaded_engine::translate(
+    const Cpu &cpu,
+    addr_t pc
+) const
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+    const addr_t mem_size = cpu.mem.get_mem_size();
+
+    block_t block{
+        pc, pc, 0, cpu.is_breakpoint( pc ), {}, nullptr, 0, {}, {}
+    };
+    block.op_vec.reserve( block_max_length + 1 );
+
+    // misaligned pcs are left to the interpreter, which traps
+    while (
+        block.length < block_max_length
+        && !(pc & (iword_size - 1))
+        && mem_size >= iword_size
+        && block.end_pc <= mem_size - iword_size
+        && (block.end_pc == pc || !cpu.is_breakpoint( block.end_pc ))
+    ) {
+        const auto instr = decoder::decode( cpu.load_iword( block.end_pc ) );
+        const auto op = translate_instr( instr, block.end_pc );
+
+        if ( !op.handler ) { break; }  // left to the interpreter
+
+        block.op_vec.push_back( op );
+        block.end_pc += iword_size;
+        ++block.length;
+
+        if ( ends_block( instr ) ) {
+            // branches, `jal`; `jalr` targets are looked up
+            auto &target_count = block.target_count;
+            if ( instr.opcode == opcode_e::branch ) {
+                block.target_arr[ target_count++ ] = op.aux;
+            }
+            if ( instr.opcode != opcode_e::jalr ) {
+                block.target_arr[ target_count++ ] = op.imm;
+            }
+
+            return block;
+        }
+    }
+    // fall through to the next block
+    block.op_vec.push_back( op_t{ op_exit, block.end_pc, 0, 0, 0, 0 } );
+    if ( block.length ) {
+        block.target_arr[ block.target_count++ ] = block.end_pc;
+    }
+
+    return block;
+}
+
+std::size_t
+Threaded_engine::exec_block(
+    Cpu &cpu,
+    const block_t &block
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+    const op_t *op = block.op_vec.data();
+
+    this->active_block = &block;
+    do {
+        op = op->handler( cpu, op );
+    } while ( op );
+    this->active_block = nullptr;
+
+    // a store to translated code leaves the block early
+    const std::size_t retired =
+            !this->invalid_vec.empty() ? (cpu.pc_reg - block.pc) / iword_size
+                                       : block.length;
+    cpu.step_count += retired;
+
+    return retired;
+}
+
+Threaded_engine::op_t
+Threaded_engine::translate_instr(
+    const instr_t &instr,
+    addr_t pc
+)
+{
+    constexpr addr_t iword_size = iword_length >> 3;
+
+    op_t op{
+        nullptr,
+        instr.imm,
+        pc + iword_size,
+        static_cast< uint8_t >( instr.rd ),
+        static_cast< uint8_t >( instr.rs1 ),
+        static_cast< uint8_t >( instr.rs2 )
+    };
+    // writes to reg_0 without side effects are dropped
+    const bool rd_0 = instr.rd == 0;
+
+    switch ( instr.mnem ) {
+    // arith_r
+        case mnem_e::ADD:   op.handler = op_arith_r< mnem_e::ADD >;   break;
+        case mnem_e::SUB:   op.handler = op_arith_r< mnem_e::SUB >;   break;
+        case mnem_e::SLL:   op.handler = op_arith_r< mnem_e::SLL >;   break;
+        case mnem_e::SLT:   op.handler = op_arith_r< mnem_e::SLT >;   break;
+        case mnem_e::SLTU:  op.handler = op_arith_r< mnem_e::SLTU >;  break;
+        case mnem_e::XOR:   op.handler = op_arith_r< mnem_e::XOR >;   break;
+        case mnem_e::SRL:   op.handler = op_arith_r< mnem_e::SRL >;   break;
+        case mnem_e::SRA:   op.handler = op_arith_r< mnem_e::SRA >;   break;
+        case mnem_e::OR:    op.handler = op_arith_r< mnem_e::OR >;    break;
+        case mnem_e::AND:   op.handler = op_arith_r< mnem_e::AND >;   break;
+    // load
+        case mnem_e::LB:   op.handler = op_load< mnem_e::LB >;   break;
+        case mnem_e::LH:   op.handler = op_load< mnem_e::LH >;   break;
+        case mnem_e::LW:   op.handler = op_load< mnem_e::LW >;   break;
+        case mnem_e::LBU:  op.handler = op_load< mnem_e::LBU >;  break;
+        case mnem_e::LHU:  op.handler = op_load< mnem_e::LHU >;  break;
+    // fence; `FENCE` is a no-op; `FENCE_I` is left to the interpreter,
+    // which drops the invalidated blocks
+        case mnem_e::FENCE:    op.handler = op_nop;  break;
+        case mnem_e::FENCE_I:  break;
+    // arith_i
+        case mnem_e::ADDI:   op.handler = op_arith_i< mnem_e::ADDI >;   break;
+        case mnem_e::SLLI:   op.handler = op_arith_i< mnem_e::SLLI >;   break;
+        case mnem_e::SLTI:   op.handler = op_arith_i< mnem_e::SLTI >;   break;
+        case mnem_e::SLTIU:  op.handler = op_arith_i< mnem_e::SLTIU >;  break;
+        case mnem_e::XORI:   op.handler = op_arith_i< mnem_e::XORI >;   break;
+        case mnem_e::SRLI:   op.handler = op_arith_i< mnem_e::SRLI >;   break;
+        case mnem_e::SRAI:   op.handler = op_arith_i< mnem_e::SRAI >;   break;
+        case mnem_e::ORI:    op.handler = op_arith_i< mnem_e::ORI >;    break;
+        case mnem_e::ANDI:   op.handler = op_arith_i< mnem_e::ANDI >;   break;
+    // jalr
+        case mnem_e::JALR:  op.handler = op_jalr;  break;
+    // system; left to the interpreter, which sees the exact step count and
+    // raises the traps
+        case mnem_e::ECALL:
+        case mnem_e::EBREAK:
+        case mnem_e::CSRRW:
+        case mnem_e::CSRRS:
+        case mnem_e::CSRRC:
+        case mnem_e::CSRRWI:
+        case mnem_e::CSRRSI:
+        case mnem_e::CSRRCI:  break;
+    // store
+        case mnem_e::SB:  op.handler = op_store< mnem_e::SB >;  break;
+        case mnem_e::SH:  op.handler = op_store< mnem_e::SH >;  break;
+        case mnem_e::SW:  op.handler = op_store< mnem_e::SW >;  break;
+    // branch
+        case mnem_e::BEQ:   op.handler = op_branch< mnem_e::BEQ >;   break;
+        case mnem_e::BNE:   op.handler = op_branch< mnem_e::BNE >;   break;
+        case mnem_e::BLT:   op.handler = op_branch< mnem_e::BLT >;   break;
+        case mnem_e::BGE:   op.handler = op_branch< mnem_e::BGE >;   break;
+        case mnem_e::BLTU:  op.handler = op_branch< mnem_e::BLTU >;  break;
+        case mnem_e::BGEU:  op.handler = op_branch< mnem_e::BGEU >;  break;
+    // auipc, lui
+        case mnem_e::AUIPC:  op.handler = op_li;
+                             op.imm = pc + instr.imm;  break;
+        case mnem_e::LUI:    op.handler = op_li;       break;
+    // jal
+        case mnem_e::JAL:  op.handler = op_jal;
+                           op.imm = pc + instr.imm;  break;
+
+        case mnem_e::_ILLEGAL:  break;  // left to the interpreter
+
+        default:  break;
+    }
+
+    switch ( instr.opcode ) {
+        case opcode_e::arith_r:
+        case opcode_e::arith_i:
+        case opcode_e::auipc:
+        case opcode_e::lui:
+            if ( rd_0 && op.handler ) { op.handler = op_nop; }  break;
+
+        default:  break;
+    }
+    // branch targets are resolved here
+    if ( instr.opcode == opcode_e::branch ) { op.imm = pc + instr.imm; }
+
+    return op;
+}
+
+bool
+Threaded_engine::ends_block(
+    const instr_t &instr
+)
+{
+    switch ( instr.opcode ) {
+        case opcode_e::jal:
+        case opcode_e::jalr:
+        case opcode_e::branch:
+            return true;
+
+        default:  return false;
+    }
+}
+
+
+
+// OP HANDLER DEFINITIONS
+
+template< mnem_e Mnem >
+const op_t *
+Threaded_engine::op_arith_r(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    cpu.reg_arr[ op->rd ] =
+            alu< Mnem >( cpu.reg_arr[ op->rs1 ], cpu.reg_arr[ op->rs2 ] );
+
+    return op + 1;
+}
+
+template< mnem_e Mnem >
+const op_t *
+Threaded_engine::op_arith_i(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    cpu.reg_arr[ op->rd ] = alu< Mnem >( cpu.reg_arr[ op->rs1 ], op->imm );
+
+    return op + 1;
+}
+
+template< mnem_e Mnem >
+const op_t *
+Threaded_engine::op_load(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    const auto &mem  = cpu.mem;
+    const addr_t addr = cpu.reg_arr[ op->rs1 ] + op->imm;
+
+    // unchecked; past the end of memory, see `Cpu::recover`
+    constexpr addr_t size = access_size< Mnem >();
+    cpu.pc_reg = op->aux - (iword_length >> 3);  // written before the access
+    std::atomic_signal_fence( std::memory_order_seq_cst );
+    word_t value;
+    if constexpr ( size == 1 ) {
+        value = mem.lb( addr );
+    } else if constexpr ( size == 2 ) {
+        value = mem.lh( addr );
+    } else {
+        value = mem.lw( addr );
+    }
+
+    cpu.reg_arr[ op->rd ] = load_extend< Mnem >( value );
+    cpu.reg_arr[ 0 ] = cpu.reg_0_value;  // restore reg_0 value
+
+    return op + 1;
+}
+
+template< mnem_e Mnem >
+const op_t *
+Threaded_engine::op_store(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    auto &mem = cpu.mem;
+    const addr_t addr = cpu.reg_arr[ op->rs1 ] + op->imm;
+    const auto   rs2  = cpu.reg_arr[ op->rs2 ];
+
+    // unchecked; past the end of memory, see `Cpu::recover`
+    constexpr addr_t size = access_size< Mnem >();
+    cpu.pc_reg = op->aux - (iword_length >> 3);  // written before the access
+    std::atomic_signal_fence( std::memory_order_seq_cst );
+    if constexpr ( size == 1 ) {
+        mem.sb( addr, static_cast< uint8_t  >( rs2 ) );
+    } else if constexpr ( size == 2 ) {
+        mem.sh( addr, static_cast< uint16_t >( rs2 ) );
+    } else {
+        mem.sw( addr, rs2 );
+    }
+    cpu.invalidate( addr, size );
+
+    // leave the block if translated code was overwritten
+    if ( !cpu.threaded_engine.invalid_vec.empty() ) {
+        cpu.pc_reg = op->aux;
+
+        return nullptr;
+    }
+
+    return op + 1;
+}
+
+template< mnem_e Mnem >
+const op_t *
+Threaded_engine::op_branch(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    const auto rs1 = cpu.reg_arr[ op->rs1 ];
+    const auto rs2 = cpu.reg_arr[ op->rs2 ];
+
+    cpu.pc_reg = taken< Mnem >( rs1, rs2 ) ? op->imm : op->aux;
+
+    return nullptr;
+}
+
+const op_t *
+Threaded_engine::op_li(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    cpu.reg_arr[ op->rd ] = op->imm;
+
+    return op + 1;
+}
+
+const op_t *
+Threaded_engine::op_jal(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    cpu.reg_arr[ op->rd ] = op->aux;
+    cpu.reg_arr[ 0 ] = cpu.reg_0_value;  // restore reg_0 value
+    cpu.pc_reg = op->imm;
+
+    return nullptr;
+}
+
+const op_t *
+Threaded_engine::op_jalr(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    const auto   rs1    = cpu.reg_arr[ op->rs1 ];
+    const addr_t target = (rs1 + op->imm) & ~word_mask( 0, 0 );
+
+    cpu.reg_arr[ op->rd ] = op->aux;
+    cpu.reg_arr[ 0 ] = cpu.reg_0_value;  // restore reg_0 value
+    cpu.pc_reg = target;
+
+    return nullptr;
+}
+
+const op_t *
+Threaded_engine::op_nop(
+    [[maybe_unused]] Cpu &cpu,
+    const op_t *op
+)
+{
+    return op + 1;
+}
+
+const op_t *
+Threaded_engine::op_exit(
+    Cpu &cpu,
+    const op_t *op
+)
+{
+    cpu.pc_reg = op->imm;
+
+    return nullptr;
+}
+
+}  // END namespace cpu_emu::cpu
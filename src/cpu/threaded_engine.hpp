@@ -0,0 +1,133 @@
+#pragma once
+
+// threaded engine
+
+
+
+// INCLUDES
+
+#include "code_map.hpp"
+#include "defines.h"
+#include "isa.hpp"
+#include "profiler.hpp"
+
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+
+
+namespace cpu_emu::cpu {
+
+// FORWARD DECLARATIONS
+
+class Cpu;
+
+
+
+// CLASS DEFINITIONS
+
+// An execution engine that translates guest basic blocks into arrays of
+// pre-resolved handler pointers ('call threading'); the reference
+// interpreter, `Cpu::step`, is used for anything not translated.
+// Each handler executes one instruction and returns the next op, or `nullptr`
+// when the block is left; `pc_reg` is only written when leaving a block and
+// before a memory access, which may leave it for `Cpu::recover`.
+// A block caches pointers to the blocks at its direct targets (chaining), so
+// that only indirect jumps look up the next block. A store to translated code
+// drops exactly the blocks it overlaps, and unlinks them, before the next
+// block is entered.
+class Threaded_engine final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    static constexpr auto iword_length = isa::iword_length;
+    static constexpr std::size_t block_max_length = BLOCK_MAX_LENGTH;
+    using word_t  = isa::word_t;
+    using addr_t  = isa::addr_t;
+    using instr_t = isa::instr_t;
+    using uint8_t = isa::uint8_t;
+
+    struct op_t;
+    using handler_t = const op_t *(*)( Cpu &cpu, const op_t *op );
+
+    struct op_t
+    {
+        handler_t handler;
+        word_t    imm;  // immediate; resolved target address for jumps
+        word_t    aux;  // next pc or link value; handler-specific
+        uint8_t   rd;
+        uint8_t   rs1;
+        uint8_t   rs2;
+    };  // END struct op_t
+
+    struct block_t
+    {
+        addr_t      pc;          // address of the first instruction
+        addr_t      end_pc;      // address past the last instruction
+        std::size_t length;      // instruction count; excludes the exit op
+        bool        breakpoint;  // the block starts at a breakpoint
+        std::vector< op_t > op_vec;
+        Profiler::block_t *profile;  // counters; set while profiling
+        // direct targets, and their blocks once chained
+        std::size_t target_count;
+        std::array< addr_t,    2 > target_arr;
+        std::array< block_t *, 2 > link_arr;
+    };  // END struct block_t
+
+
+// DATA MEMBERS
+private:
+    std::unordered_map< addr_t, block_t > block_map;
+    // by target; pcs of the blocks with it as a direct target
+    std::unordered_map< addr_t, std::vector< addr_t > > source_map;
+    Code_map code_map;
+    std::vector< addr_t > invalid_vec;  // blocks to drop; deferred
+    const block_t *active_block = nullptr;  // in `exec_block`; for `recover`
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    Threaded_engine();
+    ~Threaded_engine();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    void run( Cpu &cpu, std::size_t step_count );
+    void invalidate( addr_t addr, addr_t size );
+    void drop_invalid();  // the blocks invalidated; done by `run` otherwise
+    void recover( Cpu &cpu );  // counts the steps of a block left by a fault
+    void clear();
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    block_t &next_block( Cpu &cpu, block_t *prev );  // at `pc_reg`
+    block_t &find_block( Cpu &cpu, addr_t pc );
+    void drop_block( addr_t pc );
+    block_t translate( const Cpu &cpu, addr_t pc ) const;
+    std::size_t exec_block( Cpu &cpu, const block_t &block );
+    static op_t translate_instr( const instr_t &instr, addr_t pc );
+    static bool ends_block( const instr_t &instr );
+
+    // op handlers
+    template< isa::mnem_e Mnem >
+    static const op_t *op_arith_r( Cpu &cpu, const op_t *op );
+    template< isa::mnem_e Mnem >
+    static const op_t *op_arith_i( Cpu &cpu, const op_t *op );
+    template< isa::mnem_e Mnem >
+    static const op_t *op_load( Cpu &cpu, const op_t *op );
+    template< isa::mnem_e Mnem >
+    static const op_t *op_store( Cpu &cpu, const op_t *op );
+    template< isa::mnem_e Mnem >
+    static const op_t *op_branch( Cpu &cpu, const op_t *op );
+    static const op_t *op_li( Cpu &cpu, const op_t *op );
+    static const op_t *op_jal( Cpu &cpu, const op_t *op );
+    static const op_t *op_jalr( Cpu &cpu, const op_t *op );
+    static const op_t *op_nop( Cpu &cpu, const op_t *op );
+    static const op_t *op_exit( Cpu &cpu, const op_t *op );
+};  // END class Threaded_engine
+
+}  // END namespace cpu_emu::cpu
@@ -0,0 +1,413 @@
+// execution trace
+
+
+
+// INCLUDES
+
+#include "trace.hpp"
+
+#include "isa.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>  // gzopen, gzwrite, gzread, gzclose
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::isa;
+using namespace cpu_emu::trace;
+
+
+
+// CONSTEXPR DEFINITIONS
+
+// The file is a gzip stream of the magic and then the records, each as:
+// a varint of the pc, as a zigzag delta from the sequential pc, shifted
+// left by one, with the low bit set if the instruction word follows; if so,
+// the word as 4 bytes; `rd_value` and `mem_addr`, if meaningful, as zigzag
+// varint deltas from their last meaningful values.
+// The word is left out if it is the one last seen at the pc, as tracked by
+// a direct-mapped cache that the reader replays; so code is recorded once,
+// unless evicted or modified.
+constexpr char magic_carr[ 8 ] = { 'R', 'V', '3', '2', 'T', 'R', 'C', '2' };
+constexpr addr_t iword_size = iword_length >> 3;
+constexpr std::size_t iword_cache_size = 0x1000;  // must be a power of two
+constexpr std::size_t max_record_size = 5 + iword_size + 5 + 5;
+
+// field flags by opcode; see `has_rd` and `has_mem_addr`
+constexpr std::uint8_t rd_flag  = 1 << 0;
+constexpr std::uint8_t mem_flag = 1 << 1;
+constexpr auto flag_arr = []
+{
+    std::array< std::uint8_t, 1 << 7 > flag_arr_{};
+    for ( iword_t opcode_ = 0;  opcode_ < flag_arr_.size();  ++opcode_ ) {
+        const opcode_e opcode{ opcode_ };
+
+        switch ( opcode_type( opcode ) ) {
+            case opcode_type_e::store:
+            case opcode_type_e::branch:
+            case opcode_type_e::_illegal:
+                break;
+
+            default:  flag_arr_[ opcode_ ] |= rd_flag;
+        }
+        if ( opcode == opcode_e::load || opcode == opcode_e::store ) {
+            flag_arr_[ opcode_ ] |= mem_flag;
+        }
+    }
+
+    return flag_arr_;
+}();
+
+
+
+// FUNCTION DEFINITIONS
+
+std::uint8_t
+field_flags(
+    iword_t iword
+)
+{
+    auto flags = flag_arr[ iword_extract( iword, 6, 0 ) ];
+    if ( !iword_extract( iword, 11, 7 ) ) { flags &= ~rd_flag; }  // x0
+
+    return flags;
+}
+
+// zigzag; small negative deltas stay small
+std::uint64_t
+zigzag(
+    word_t delta
+)
+{
+    return word_t( delta << 1 ^ -(delta >> (word_length - 1)) );
+}
+
+word_t
+unzigzag(
+    std::uint64_t value
+)
+{
+    return word_t( value >> 1 ^ -(value & 1) );
+}
+
+std::uint8_t *
+put_varint(
+    std::uint8_t *pos,
+    std::uint64_t value
+)
+{
+    for ( ;  value >= 0x80;  value >>= 7 ) {
+        *pos++ = value | 0x80;
+    }
+    *pos++ = value;
+
+    return pos;
+}
+
+// Returns false at the end of the file, unless within a varint.
+bool
+get_varint(
+    gzFile file,
+    std::uint64_t &value
+)
+{
+    value = 0;
+    for ( unsigned shift_ = 0;  shift_ < 64;  shift_ += 7 ) {
+        const int byte = gzgetc( file );
+        if ( byte == -1 ) {
+            if ( !shift_ ) { return false; }
+            throw std::runtime_error( "Truncated trace." );
+        }
+
+        value |= std::uint64_t( byte & 0x7f ) << shift_;
+        if ( !(byte & 0x80) ) { return true; }
+    }
+
+    throw std::runtime_error( "Malformed trace." );
+}
+
+}  // END namespace
+
+
+
+namespace cpu_emu::trace {
+
+// FUNCTION DEFINITIONS
+
+bool
+has_rd(
+    iword_t iword
+)
+{
+    return field_flags( iword ) & rd_flag;
+}
+
+bool
+has_mem_addr(
+    iword_t iword
+)
+{
+    return field_flags( iword ) & mem_flag;
+}
+
+
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Writer::Writer(
+    const std::string &file_path
+):
+    file( gzopen( file_path.c_str(), "wb1" ) ),  // fast; deltas pack well
+    chunk_vec( chunk_count, std::vector< record_t >( chunk_size ) ),
+    length_vec( chunk_count, 0 ),
+    record_carr( chunk_vec.front().data() )
+{
+    if ( !this->file ) {
+        throw std::runtime_error( "Could not open '" + file_path + "'." );
+    }
+    if (
+        gzwrite( this->file, magic_carr, sizeof( magic_carr ) )
+     != sizeof( magic_carr )
+    ) {
+        gzclose( this->file );
+        throw std::runtime_error( "Could not write '" + file_path + "'." );
+    }
+
+    this->thread = std::thread( &Writer::drain, this );
+}
+
+Writer::~Writer()
+{
+    try {
+        this->close();
+    }
+    catch ( ... ) {}  // nowhere to report it; as in `console::Console`
+}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+void
+Writer::append(
+    const record_t &record
+)
+{
+    this->record_carr[ this->record_pos ] = record;
+    if ( ++this->record_pos == chunk_size ) { this->submit(); }
+}
+
+std::size_t
+Writer::close()
+{
+    if ( !this->thread.joinable() ) { return this->record_count; }
+
+    {
+        // the chunk being filled always has a free slot; see `submit`
+        std::lock_guard< std::mutex > lock( this->mutex );
+        if ( this->record_pos ) { this->hand_over(); }
+        this->closing = true;
+    }
+    this->cv.notify_all();
+    this->thread.join();
+
+    const bool ok = gzclose( this->file ) == Z_OK;
+    if ( this->error ) { std::rethrow_exception( this->error ); }
+    if ( !ok ) { throw std::runtime_error( "Could not write the trace." ); }
+
+    return this->record_count;
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+void
+Writer::submit()
+{
+    std::unique_lock< std::mutex > lock( this->mutex );
+    this->hand_over();
+
+    // backpressure; the next chunk must have been written out
+    this->cv.wait( lock, [ this ] {
+        return this->submit_count - this->drain_count < chunk_count;
+    } );
+    this->record_carr =
+            this->chunk_vec[ this->submit_count % chunk_count ].data();
+
+    if ( this->error ) { std::rethrow_exception( this->error ); }
+}
+
+void
+Writer::hand_over()
+{
+    this->length_vec[ this->submit_count % chunk_count ] = this->record_pos;
+    this->record_count += this->record_pos;
+    this->record_pos = 0;
+    ++this->submit_count;
+    this->cv.notify_all();
+}
+
+void
+Writer::drain()
+{
+    std::vector< std::uint8_t > byte_vec( chunk_size * max_record_size );
+    std::vector< iword_entry_t > iword_cache_vec( iword_cache_size );
+    record_t prev{ 0, 0, 0, 0 };
+
+    for ( ;; ) {
+        std::unique_lock< std::mutex > lock( this->mutex );
+        this->cv.wait( lock, [ this ] {
+            return this->drain_count != this->submit_count || this->closing;
+        } );
+        if ( this->drain_count == this->submit_count ) { return; }  // closing
+        const auto index  = this->drain_count % chunk_count;
+        const auto length = this->length_vec[ index ];
+        lock.unlock();
+
+        // the chunk is not touched by the core until it is drained
+        auto *pos = byte_vec.data();
+        for ( std::size_t i_ = 0;  i_ < length;  ++i_ ) {
+            const auto &record = this->chunk_vec[ index ][ i_ ];
+            auto &entry = iword_cache_vec[
+                    record.pc / iword_size & (iword_cache_size - 1) ];
+            const bool fresh = entry.pc != record.pc
+                            || entry.iword != record.iword;
+            const auto flags = field_flags( record.iword );
+
+            pos = put_varint(
+                    pos, zigzag( record.pc - (prev.pc + iword_size) ) << 1
+                       | fresh );
+            prev.pc = record.pc;
+            if ( fresh ) {
+                entry = { record.pc, record.iword };
+                for ( unsigned byte_ = 0;  byte_ < iword_size;  ++byte_ ) {
+                    *pos++ = record.iword >> byte_ * 8;
+                }
+            }
+            if ( flags & rd_flag ) {
+                pos = put_varint(
+                        pos, zigzag( record.rd_value - prev.rd_value ) );
+                prev.rd_value = record.rd_value;
+            }
+            if ( flags & mem_flag ) {
+                pos = put_varint(
+                        pos, zigzag( record.mem_addr - prev.mem_addr ) );
+                prev.mem_addr = record.mem_addr;
+            }
+        }
+        const auto byte_count = unsigned( pos - byte_vec.data() );
+
+        const bool ok = !this->error
+                     && gzwrite( this->file, byte_vec.data(), byte_count )
+                     == int( byte_count );
+
+        lock.lock();
+        if ( !ok && !this->error ) {
+            this->error = std::make_exception_ptr(
+                    std::runtime_error( "Could not write the trace." ) );
+        }
+        ++this->drain_count;  // even on error; the core must not wait forever
+        this->cv.notify_all();
+    }
+}
+
+
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+Reader::Reader(
+    const std::string &file_path
+):
+    file( gzopen( file_path.c_str(), "rb" ) ),
+    iword_cache_vec( iword_cache_size )
+{
+    if ( !this->file ) {
+        throw std::runtime_error( "Could not open '" + file_path + "'." );
+    }
+
+    char carr[ sizeof( magic_carr ) ];
+    if (
+        gzread( this->file, carr, sizeof( carr ) ) != sizeof( carr )
+     || std::memcmp( carr, magic_carr, sizeof( carr ) )
+    ) {
+        gzclose( this->file );
+        throw std::runtime_error( "Not a trace: '" + file_path + "'." );
+    }
+}
+
+Reader::~Reader()
+{
+    gzclose( this->file );
+}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+bool
+Reader::read(
+    record_t &record
+)
+{
+    auto &prev = this->prev;
+    std::uint64_t value;
+
+    if ( !get_varint( this->file, value ) ) { return false; }
+    record.pc = prev.pc + iword_size + unzigzag( value >> 1 );
+    prev.pc   = record.pc;
+
+    auto &entry = this->iword_cache_vec[
+            record.pc / iword_size & (iword_cache_size - 1) ];
+    if ( value & 1 ) {
+        std::uint8_t byte_carr[ iword_size ];
+        if (
+            gzread( this->file, byte_carr, iword_size ) != int( iword_size )
+        ) {
+            throw std::runtime_error( "Truncated trace." );
+        }
+        entry.pc    = record.pc;
+        entry.iword = 0;
+        for ( unsigned byte_ = 0;  byte_ < iword_size;  ++byte_ ) {
+            entry.iword |= iword_t( byte_carr[ byte_ ] ) << byte_ * 8;
+        }
+    }
+    else if ( entry.pc != record.pc ) {
+        throw std::runtime_error( "Malformed trace." );
+    }
+    record.iword = entry.iword;
+
+    const auto flags = field_flags( record.iword );
+    record.rd_value = 0;
+    if ( flags & rd_flag ) {
+        if ( !get_varint( this->file, value ) ) {
+            throw std::runtime_error( "Truncated trace." );
+        }
+        record.rd_value = prev.rd_value += unzigzag( value );
+    }
+    record.mem_addr = 0;
+    if ( flags & mem_flag ) {
+        if ( !get_varint( this->file, value ) ) {
+            throw std::runtime_error( "Truncated trace." );
+        }
+        record.mem_addr = prev.mem_addr += unzigzag( value );
+    }
+
+    return true;
+}
+
+}  // END namespace cpu_emu::trace
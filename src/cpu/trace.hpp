@@ -0,0 +1,133 @@
+#pragma once
+
+// execution trace
+
+
+
+// INCLUDES
+
+#include "defines.h"
+#include "isa.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>  // gzFile
+
+
+
+namespace cpu_emu::trace {
+
+// STRUCT DEFINITIONS
+
+// One retired instruction. Whether `rd_value` and `mem_addr` are meaningful
+// follows from `iword`: the former unless the format has no `rd` (stores,
+// branches), the latter for loads and stores.
+struct record_t
+{
+    isa::addr_t  pc;
+    isa::iword_t iword;
+    isa::word_t  rd_value;  // `rd` after the instruction
+    isa::addr_t  mem_addr;  // effective address
+};  // END struct record_t
+
+// A cached instruction word; see the file format in `trace.cpp`.
+struct iword_entry_t
+{
+    isa::addr_t  pc;
+    isa::iword_t iword;
+};  // END struct iword_entry_t
+
+
+
+// CLASS DEFINITIONS
+
+// Writes records to a compressed trace file on a background thread.
+// Records are appended to a ring of chunks; a full chunk is handed to the
+// thread, which delta-encodes and compresses it. If every chunk is still
+// being written, `append` waits, so that no record is ever dropped.
+class Writer final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    static constexpr std::size_t chunk_size  = TRACE_CHUNK_SIZE;
+    static constexpr std::size_t chunk_count = TRACE_CHUNK_COUNT;
+
+
+// DATA MEMBERS
+private:
+    gzFile file;
+    std::vector< std::vector< record_t > > chunk_vec;  // the ring
+    std::vector< std::size_t > length_vec;  // records per submitted chunk
+    record_t   *record_carr;     // of the chunk being filled
+    std::size_t record_pos = 0;  // in the chunk being filled
+    std::size_t record_count = 0;  // in all submitted chunks
+    // shared with the thread; guarded by `mutex`
+    std::mutex              mutex;
+    std::condition_variable cv;
+    std::size_t             submit_count = 0;  // chunks handed to the thread
+    std::size_t             drain_count  = 0;  // chunks written by it
+    bool                    closing      = false;
+    std::exception_ptr      error;  // of the thread; rethrown by the core
+    std::thread             thread;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    explicit Writer( const std::string &file_path );
+    Writer( const Writer & ) = delete;
+    Writer &operator=( const Writer & ) = delete;
+    ~Writer();  // closes; errors are lost
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    void append( const record_t &record );  // may wait; see above
+    // Writes out everything appended; returns the record count.
+    // The writer cannot be used afterwards.
+    std::size_t close();
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    void submit();     // hands over the chunk being filled; may wait
+    void hand_over();  // with `mutex` held
+    void drain();      // the thread
+};  // END class Writer
+
+// Reads the records of a trace file in order.
+class Reader final
+{
+// DATA MEMBERS
+private:
+    gzFile   file;
+    record_t prev{ 0, 0, 0, 0 };  // the delta base
+    std::vector< iword_entry_t > iword_cache_vec;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    explicit Reader( const std::string &file_path );
+    Reader( const Reader & ) = delete;
+    Reader &operator=( const Reader & ) = delete;
+    ~Reader();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    bool read( record_t &record );  // false at the end of the trace
+};  // END class Reader
+
+
+
+// FUNCTION DECLARATIONS
+
+bool has_rd( isa::iword_t iword );  // whether `rd_value` is meaningful
+bool has_mem_addr( isa::iword_t iword );  // whether `mem_addr` is
+
+}  // END namespace cpu_emu::trace
@@ -0,0 +1,76 @@
+// trace dump
+
+
+
+// INCLUDES
+
+#include "decoder.hpp"
+#include "isa.hpp"
+#include "trace.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+
+
+namespace {
+
+// USED NAMESPACES
+
+using namespace cpu_emu::cpu;
+using namespace cpu_emu::isa;
+using namespace cpu_emu::trace;
+
+}  // END namespace
+
+
+
+// MAIN FUNCTION
+
+int
+main(
+    int argc,
+    char *argv[]
+)
+{
+    const std::string usage = std::string( "Usage: " ) + argv[ 0 ]
+            + " <trace_path> [<max_count>]";
+
+    if ( argc < 2 || argc > 3 ) {
+        std::cout << usage << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    const std::size_t max_count = argc > 2
+                                ? std::stoull( argv[ 2 ], nullptr, 0 )
+                                : -1;
+
+    // one line per record: pc, instruction word, mnem, and the register
+    // write and effective address, where meaningful
+    Reader reader( argv[ 1 ] );
+    std::cout << std::hex << std::setfill( '0' );
+    std::size_t count = 0;
+    for ( record_t record;  count < max_count && reader.read( record ); ) {
+        const auto instr = decoder::decode_compact( record.iword );
+
+        std::cout << std::setw( 8 ) << record.pc << ": "
+                  << std::setw( 8 ) << record.iword << " "
+                  << mnem_str( instr.mnem );
+        if ( has_rd( record.iword ) ) {
+            std::cout << " x" << std::dec << unsigned( instr.rd ) << std::hex
+                      << "=" << std::setw( 8 ) << record.rd_value;
+        }
+        if ( has_mem_addr( record.iword ) ) {
+            std::cout << " @" << std::setw( 8 ) << record.mem_addr;
+        }
+        std::cout << '\n';
+        ++count;
+    }
+    std::cout << std::dec << "trace_dump: record_count: " << count << std::endl;
+
+    return EXIT_SUCCESS;
+}
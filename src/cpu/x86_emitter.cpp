@@ -0,0 +1,409 @@
+// x86-64 emitter
+
+
+
+// INCLUDES
+
+#include "x86_emitter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+
+namespace cpu_emu::cpu {
+
+// CONSTRUCTOR, DESTRUCTOR DEFINITIONS
+
+X86_emitter::X86_emitter(
+    uint8_t *begin_ptr,
+    uint8_t *end_ptr
+):
+    begin_ptr( begin_ptr ),
+    cur_ptr( begin_ptr ),
+    end_ptr( end_ptr )
+{}
+
+X86_emitter::~X86_emitter()
+{}
+
+
+
+// PUBLIC MEMBER-FUNCTION DEFINITIONS
+
+bool
+X86_emitter::is_ok() const
+{
+    return !this->overflow;
+}
+
+std::size_t
+X86_emitter::get_size() const
+{
+    return this->cur_ptr - this->begin_ptr;
+}
+
+void
+X86_emitter::mov_rr(
+    reg_e dst,
+    reg_e src
+)
+{
+    this->emit_rex( false, src, 0, dst );
+    this->emit8( 0x89 );
+    this->emit_modrm_rr( src, dst );
+}
+
+void
+X86_emitter::mov_ri(
+    reg_e dst,
+    uint32_t imm
+)
+{
+    this->emit_rex( false, 0, 0, dst );
+    this->emit8( 0xb8 + (dst & 7) );
+    this->emit32( imm );
+}
+
+void
+X86_emitter::mov_rm(
+    reg_e dst,
+    reg_e base,
+    int8_t disp
+)
+{
+    this->emit_rex( false, dst, 0, base );
+    this->emit8( 0x8b );
+    this->emit_modrm_disp8( dst, base, disp );
+}
+
+void
+X86_emitter::mov_mr(
+    reg_e base,
+    int8_t disp,
+    reg_e src
+)
+{
+    this->emit_rex( false, src, 0, base );
+    this->emit8( 0x89 );
+    this->emit_modrm_disp8( src, base, disp );
+}
+
+void
+X86_emitter::mov_mi(
+    reg_e base,
+    int8_t disp,
+    uint32_t imm
+)
+{
+    this->emit_rex( false, 0, 0, base );
+    this->emit8( 0xc7 );
+    this->emit_modrm_disp8( 0, base, disp );
+    this->emit32( imm );
+}
+
+void
+X86_emitter::mov64_rm(
+    reg_e dst,
+    reg_e base,
+    int8_t disp
+)
+{
+    this->emit_rex( true, dst, 0, base );
+    this->emit8( 0x8b );
+    this->emit_modrm_disp8( dst, base, disp );
+}
+
+void
+X86_emitter::alu_rr(
+    alu_e op,
+    reg_e dst,
+    reg_e src
+)
+{
+    this->emit_rex( false, src, 0, dst );
+    this->emit8( static_cast< uint8_t >( op ) << 3 | 0x01 );  // r/m, r
+    this->emit_modrm_rr( src, dst );
+}
+
+void
+X86_emitter::alu_ri(
+    alu_e op,
+    reg_e dst,
+    uint32_t imm
+)
+{
+    this->emit_rex( false, 0, 0, dst );
+    this->emit8( 0x81 );
+    this->emit_modrm_rr( static_cast< uint8_t >( op ), dst );
+    this->emit32( imm );
+}
+
+void
+X86_emitter::alu_rm(
+    alu_e op,
+    reg_e dst,
+    reg_e base,
+    int8_t disp
+)
+{
+    this->emit_rex( false, dst, 0, base );
+    this->emit8( static_cast< uint8_t >( op ) << 3 | 0x03 );  // r, r/m
+    this->emit_modrm_disp8( dst, base, disp );
+}
+
+void
+X86_emitter::alu_mi(
+    alu_e op,
+    reg_e base,
+    int8_t disp,
+    uint32_t imm
+)
+{
+    this->emit_rex( false, 0, 0, base );
+    this->emit8( 0x81 );
+    this->emit_modrm_disp8( static_cast< uint8_t >( op ), base, disp );
+    this->emit32( imm );
+}
+
+void
+X86_emitter::shift_ri(
+    shift_e op,
+    reg_e dst,
+    uint8_t imm
+)
+{
+    this->emit_rex( false, 0, 0, dst );
+    this->emit8( 0xc1 );
+    this->emit_modrm_rr( static_cast< uint8_t >( op ), dst );
+    this->emit8( imm );
+}
+
+void
+X86_emitter::shift_rcl(
+    shift_e op,
+    reg_e dst
+)
+{
+    this->emit_rex( false, 0, 0, dst );
+    this->emit8( 0xd3 );
+    this->emit_modrm_rr( static_cast< uint8_t >( op ), dst );
+}
+
+void
+X86_emitter::setcc_movzx(
+    cond_e cond,
+    reg_e dst
+)
+{
+    // setcc dst8; REX needed to address the low bytes of rsp..rdi
+    this->emit_rex( false, 0, 0, dst, dst >= rsp );
+    this->emit8( 0x0f );
+    this->emit8( 0x90 | static_cast< uint8_t >( cond ) );
+    this->emit_modrm_rr( 0, dst );
+    // movzx dst, dst8
+    this->emit_rex( false, dst, 0, dst, dst >= rsp );
+    this->emit8( 0x0f );
+    this->emit8( 0xb6 );
+    this->emit_modrm_rr( dst, dst );
+}
+
+void
+X86_emitter::load(
+    width_e width,
+    bool sign,
+    reg_e dst,
+    reg_e base,
+    reg_e index
+)
+{
+    this->emit_rex( false, dst, index, base );
+    switch ( width ) {
+        case width_e::byte:
+            this->emit8( 0x0f );  this->emit8( sign ? 0xbe : 0xb6 );  break;
+        case width_e::half:
+            this->emit8( 0x0f );  this->emit8( sign ? 0xbf : 0xb7 );  break;
+        case width_e::word:
+            this->emit8( 0x8b );                                      break;
+    }
+    this->emit_modrm_sib( dst, base, index );
+}
+
+void
+X86_emitter::store(
+    width_e width,
+    reg_e base,
+    reg_e index,
+    reg_e src
+)
+{
+    switch ( width ) {
+        case width_e::byte:
+            this->emit_rex( false, src, index, base, src >= rsp );
+            this->emit8( 0x88 );
+            break;
+        case width_e::half:
+            this->emit8( 0x66 );  // operand-size prefix precedes REX
+            this->emit_rex( false, src, index, base );
+            this->emit8( 0x89 );
+            break;
+        case width_e::word:
+            this->emit_rex( false, src, index, base );
+            this->emit8( 0x89 );
+            break;
+    }
+    this->emit_modrm_sib( src, base, index );
+}
+
+void
+X86_emitter::store_i8(
+    reg_e base,
+    reg_e index,
+    uint8_t imm
+)
+{
+    this->emit_rex( false, 0, index, base );
+    this->emit8( 0xc6 );
+    this->emit_modrm_sib( 0, base, index );
+    this->emit8( imm );
+}
+
+void
+X86_emitter::push(
+    reg_e reg
+)
+{
+    this->emit_rex( false, 0, 0, reg );
+    this->emit8( 0x50 + (reg & 7) );
+}
+
+void
+X86_emitter::pop(
+    reg_e reg
+)
+{
+    this->emit_rex( false, 0, 0, reg );
+    this->emit8( 0x58 + (reg & 7) );
+}
+
+void
+X86_emitter::ret()
+{
+    this->emit8( 0xc3 );
+}
+
+std::size_t
+X86_emitter::jcc(
+    cond_e cond
+)
+{
+    this->emit8( 0x0f );
+    this->emit8( 0x80 | static_cast< uint8_t >( cond ) );
+    this->emit32( 0 );  // patched by `bind`
+
+    return this->get_size();
+}
+
+std::size_t
+X86_emitter::jmp()
+{
+    this->emit8( 0xe9 );
+    this->emit32( 0 );  // patched by `bind`
+
+    return this->get_size();
+}
+
+void
+X86_emitter::bind(
+    std::size_t label
+)
+{
+    if ( this->overflow ) { return; }
+
+    // `label` is the offset just past the rel32 field
+    const uint32_t rel = this->get_size() - label;
+    std::memcpy( this->begin_ptr + label - 4, &rel, 4 );
+}
+
+
+
+// PRIVATE MEMBER-FUNCTION DEFINITIONS
+
+void
+X86_emitter::emit8(
+    uint8_t byte
+)
+{
+    if ( this->cur_ptr == this->end_ptr ) {
+        this->overflow = true;
+
+        return;
+    }
+
+    *this->cur_ptr++ = byte;
+}
+
+void
+X86_emitter::emit32(
+    uint32_t word
+)
+{
+    for ( unsigned i_ = 0;  i_ < 4;  ++i_ ) {
+        this->emit8( word >> (i_ * 8) );
+    }
+}
+
+void
+X86_emitter::emit_rex(
+    bool w,
+    unsigned reg,
+    unsigned index,
+    unsigned base,
+    bool force
+)
+{
+    const uint8_t rex = 0x40
+                      | w << 3
+                      | (reg   >> 3) << 2
+                      | (index >> 3) << 1
+                      | (base  >> 3);
+
+    if ( rex != 0x40 || force ) { this->emit8( rex ); }
+}
+
+void
+X86_emitter::emit_modrm_rr(
+    unsigned reg,
+    unsigned rm
+)
+{
+    this->emit8( 0xc0 | (reg & 7) << 3 | (rm & 7) );
+}
+
+void
+X86_emitter::emit_modrm_disp8(
+    unsigned reg,
+    unsigned base,
+    int8_t disp
+)
+{
+    this->emit8( 0x40 | (reg & 7) << 3 | (base & 7) );
+    if ( (base & 7) == rsp ) { this->emit8( 0x24 ); }  // SIB; no index
+    this->emit8( disp );
+}
+
+void
+X86_emitter::emit_modrm_sib(
+    unsigned reg,
+    unsigned base,
+    unsigned index
+)
+{
+    // mod 01 with a zero disp8; mod 00 would mean no base for rbp/r13
+    this->emit8( 0x44 | (reg & 7) << 3 );
+    this->emit8( (index & 7) << 3 | (base & 7) );
+    this->emit8( 0 );
+}
+
+}  // END namespace cpu_emu::cpu
@@ -0,0 +1,116 @@
+#pragma once
+
+// x86-64 emitter
+
+
+
+// INCLUDES
+
+#include <cstddef>
+#include <cstdint>
+
+
+
+namespace cpu_emu::cpu {
+
+// CLASS DEFINITIONS
+
+// A minimal x86-64 machine-code emitter for the JIT engine.
+// Unless noted otherwise, instructions operate on 32-bit registers.
+// Memory operands are either `[base + disp8]` or `[base + index]`.
+// Emission past the end of the buffer sets an overflow flag instead of
+// writing; the caller is expected to check `is_ok` before using the code.
+class X86_emitter final
+{
+// TYPE, CONSTEXPR MEMBERS
+public:
+    using uint8_t  = std::uint8_t;
+    using int8_t   = std::int8_t;
+    using uint32_t = std::uint32_t;
+
+    enum reg_e : uint8_t
+    {
+        rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi,
+        r8,  r9,  r10, r11, r12, r13, r14, r15,
+    };  // END enum reg_e
+
+    // the value is the `/digit` of the group-1 opcodes
+    enum class alu_e : uint8_t
+    {
+        add = 0, or_ = 1, and_ = 4, sub = 5, xor_ = 6, cmp = 7,
+    };  // END enum class alu_e
+
+    // the value is the `/digit` of the group-2 opcodes
+    enum class shift_e : uint8_t
+    {
+        shl = 4, shr = 5, sar = 7,
+    };  // END enum class shift_e
+
+    // the value is the condition-code nibble
+    enum class cond_e : uint8_t
+    {
+        b = 0x2, ae = 0x3, e = 0x4, ne = 0x5, be = 0x6, a = 0x7,
+        l = 0xc, ge = 0xd,
+    };  // END enum class cond_e
+
+    enum class width_e : uint8_t
+    {
+        byte, half, word,
+    };  // END enum class width_e
+
+
+// DATA MEMBERS
+private:
+    uint8_t *begin_ptr;
+    uint8_t *cur_ptr;
+    uint8_t *end_ptr;
+    bool     overflow = false;
+
+
+// CONSTRUCTOR, DESTRUCTOR DECLARATIONS
+public:
+    X86_emitter( uint8_t *begin_ptr, uint8_t *end_ptr );
+    ~X86_emitter();
+
+
+// PUBLIC MEMBER-FUNCTION DECLARATIONS
+public:
+    bool is_ok() const;
+    std::size_t get_size() const;
+
+    void mov_rr( reg_e dst, reg_e src );
+    void mov_ri( reg_e dst, uint32_t imm );
+    void mov_rm( reg_e dst, reg_e base, int8_t disp );
+    void mov_mr( reg_e base, int8_t disp, reg_e src );
+    void mov_mi( reg_e base, int8_t disp, uint32_t imm );
+    void mov64_rm( reg_e dst, reg_e base, int8_t disp );
+    void alu_rr( alu_e op, reg_e dst, reg_e src );
+    void alu_ri( alu_e op, reg_e dst, uint32_t imm );
+    void alu_rm( alu_e op, reg_e dst, reg_e base, int8_t disp );
+    void alu_mi( alu_e op, reg_e base, int8_t disp, uint32_t imm );
+    void shift_ri( shift_e op, reg_e dst, uint8_t imm );
+    void shift_rcl( shift_e op, reg_e dst );
+    void setcc_movzx( cond_e cond, reg_e dst );  // `dst` = cond ? 1 : 0
+    void load( width_e width, bool sign, reg_e dst, reg_e base, reg_e index );
+    void store( width_e width, reg_e base, reg_e index, reg_e src );
+    void store_i8( reg_e base, reg_e index, uint8_t imm );
+    void push( reg_e reg );
+    void pop( reg_e reg );
+    void ret();
+    std::size_t jcc( cond_e cond );  // returns a label to `bind`
+    std::size_t jmp();               // returns a label to `bind`
+    void bind( std::size_t label );  // resolves the jump to here
+
+
+// PRIVATE MEMBER-FUNCTION DECLARATIONS
+private:
+    void emit8( uint8_t byte );
+    void emit32( uint32_t word );
+    void emit_rex( bool w, unsigned reg, unsigned index, unsigned base,
+                   bool force = false );
+    void emit_modrm_rr( unsigned reg, unsigned rm );
+    void emit_modrm_disp8( unsigned reg, unsigned base, int8_t disp );
+    void emit_modrm_sib( unsigned reg, unsigned base, unsigned index );
+};  // END class X86_emitter
+
+}  // END namespace cpu_emu::cpu
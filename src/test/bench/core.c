@@ -0,0 +1,218 @@
+// core benchmark; a CoreMark-style mix of list, matrix, and state-machine
+// work, with the results folded into a CRC-16
+
+
+
+// INCLUDES
+
+#include "../util/bench_utils.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+// DEFINES
+
+#define CORE_ITER_COUNT   200
+#define CORE_LIST_LENGTH  64
+#define CORE_MAT_SIZE     8
+#define CORE_STATE_LENGTH 256
+#define CORE_EXPECTED     0x0000cf3cu
+
+
+
+// TYPE DEFINITIONS
+
+typedef struct node_t
+{
+    struct node_t *next;
+    int16_t        key;
+    int16_t        value;
+} node_t;
+
+
+
+// STATIC DATA
+
+static node_t node_arr[ CORE_LIST_LENGTH ];
+static int16_t mat_a[ CORE_MAT_SIZE ][ CORE_MAT_SIZE ];
+static int16_t mat_b[ CORE_MAT_SIZE ][ CORE_MAT_SIZE ];
+static int32_t mat_c[ CORE_MAT_SIZE ][ CORE_MAT_SIZE ];
+static char    state_carr[ CORE_STATE_LENGTH ];
+
+
+
+// STATIC FUNCTION DEFINITIONS
+
+static
+uint16_t
+crc16(
+    uint16_t crc,
+    uint16_t word
+)
+{
+    for ( int bit_ = 0;  bit_ < 16;  ++bit_ ) {
+        const bool carry = (crc ^ word) & 1;
+        crc  >>= 1;
+        word >>= 1;
+        if ( carry ) { crc ^= 0xa001; }
+    }
+
+    return crc;
+}
+
+// list: reverse, then find a key and sum the values up to it
+static
+node_t *
+list_reverse(
+    node_t *head
+)
+{
+    node_t *prev = NULL;
+    while ( head ) {
+        node_t *next = head->next;
+        head->next = prev;
+        prev = head;
+        head = next;
+    }
+
+    return prev;
+}
+
+static
+int16_t
+list_work(
+    node_t **head,
+    int16_t key
+)
+{
+    int16_t sum = 0;
+    *head = list_reverse( *head );
+    for ( node_t *node = *head;  node;  node = node->next ) {
+        sum += node->value;
+        if ( node->key == key ) {
+            node->value ^= sum;
+
+            break;
+        }
+    }
+
+    return sum;
+}
+
+// matrix: multiply, then add a constant and reduce
+static
+int32_t
+matrix_work(
+    int16_t c
+)
+{
+    int32_t sum = 0;
+    for ( size_t i_ = 0;  i_ < CORE_MAT_SIZE;  ++i_ ) {
+        for ( size_t j_ = 0;  j_ < CORE_MAT_SIZE;  ++j_ ) {
+            int32_t dot = 0;
+            for ( size_t k_ = 0;  k_ < CORE_MAT_SIZE;  ++k_ ) {
+                dot += mat_a[ i_ ][ k_ ] * mat_b[ k_ ][ j_ ];
+            }
+            mat_c[ i_ ][ j_ ] = dot;
+            sum += dot > c ? 1 : dot;
+        }
+    }
+    for ( size_t i_ = 0;  i_ < CORE_MAT_SIZE;  ++i_ ) {
+        for ( size_t j_ = 0;  j_ < CORE_MAT_SIZE;  ++j_ ) {
+            mat_a[ i_ ][ j_ ] += c;
+        }
+    }
+
+    return sum;
+}
+
+// state machine: classify the comma-separated tokens of `state_carr`
+enum state_e
+{
+    state_start,
+    state_int,
+    state_float,
+    state_exp,
+    state_invalid,
+    state_count,
+};
+
+static
+uint32_t
+state_work( void )
+{
+    uint32_t count_arr[ state_count ] = { 0 };
+    enum state_e state = state_start;
+
+    for ( size_t i_ = 0;  i_ < CORE_STATE_LENGTH;  ++i_ ) {
+        const char c = state_carr[ i_ ];
+        if ( c == ',' ) {
+            ++count_arr[ state ];
+            state = state_start;
+
+            continue;
+        }
+
+        const bool digit = c >= '0' && c <= '9';
+        switch ( state ) {
+            case state_start:
+                state = digit || c == '-' ? state_int : state_invalid;  break;
+            case state_int:
+                state = digit    ? state_int
+                      : c == '.' ? state_float : state_invalid;  break;
+            case state_float:
+                state = digit    ? state_float
+                      : c == 'e' ? state_exp : state_invalid;  break;
+            case state_exp:
+                state = digit ? state_exp : state_invalid;  break;
+
+            default:  break;
+        }
+    }
+
+    uint32_t result = 0;
+    for ( int state_ = 0;  state_ < state_count;  ++state_ ) {
+        result = result * 31 + count_arr[ state_ ];
+    }
+
+    return result;
+}
+
+
+
+// MAIN FUNCTION
+
+int
+main( void )
+{
+    static const char token_carr[ 16 ] = "0123456789-.e,,x";  // unterminated
+    uint32_t state = 0x6c078965;
+    uint16_t crc   = 0;
+
+    node_t *head = NULL;
+    for ( int i_ = CORE_LIST_LENGTH - 1;  i_ >= 0;  --i_ ) {
+        node_arr[ i_ ] = (node_t){ head, i_, bench_rand( &state ) & 0x7fff };
+        head = &node_arr[ i_ ];
+    }
+    for ( size_t i_ = 0;  i_ < CORE_MAT_SIZE;  ++i_ ) {
+        for ( size_t j_ = 0;  j_ < CORE_MAT_SIZE;  ++j_ ) {
+            mat_a[ i_ ][ j_ ] = bench_rand( &state ) & 0xff;
+            mat_b[ i_ ][ j_ ] = bench_rand( &state ) & 0xff;
+        }
+    }
+
+    for ( uint32_t iter_ = 0;  iter_ < CORE_ITER_COUNT;  ++iter_ ) {
+        for ( size_t i_ = 0;  i_ < CORE_STATE_LENGTH;  ++i_ ) {
+            state_carr[ i_ ] = token_carr[ bench_rand( &state ) & 0xf ];
+        }
+
+        crc = crc16( crc, list_work( &head, iter_ % CORE_LIST_LENGTH ) );
+        crc = crc16( crc, matrix_work( iter_ ) );
+        crc = crc16( crc, state_work() );
+    }
+
+    return bench_check( "core", crc, CORE_EXPECTED );
+}
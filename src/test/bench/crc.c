@@ -0,0 +1,105 @@
+// crc benchmark
+
+
+
+// INCLUDES
+
+#include "../util/bench_utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+// DEFINES
+
+#define CRC_LENGTH            0x4000  // 16 KiB
+#define CRC_BITWISE_REP_COUNT 8
+#define CRC_TABLE_REP_COUNT   64
+#define CRC_POLY              0xedb88320u  // CRC-32 (IEEE 802.3), reflected
+#define CRC_EXPECTED          0x93070589u
+
+
+
+// STATIC DATA
+
+static uint8_t  byte_arr[ CRC_LENGTH ];
+static uint32_t crc_table[ 0x100 ];
+
+
+
+// STATIC FUNCTION DEFINITIONS
+
+static
+uint32_t
+crc_bitwise(
+    const uint8_t *arr,
+    size_t length
+)
+{
+    uint32_t crc = ~0u;
+    for ( size_t i_ = 0;  i_ < length;  ++i_ ) {
+        crc ^= arr[ i_ ];
+        for ( int bit_ = 0;  bit_ < 8;  ++bit_ ) {
+            crc = crc >> 1 ^ (CRC_POLY & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+static
+void
+init_table( void )
+{
+    for ( uint32_t i_ = 0;  i_ < 0x100;  ++i_ ) {
+        uint32_t crc = i_;
+        for ( int bit_ = 0;  bit_ < 8;  ++bit_ ) {
+            crc = crc >> 1 ^ (CRC_POLY & -(crc & 1));
+        }
+        crc_table[ i_ ] = crc;
+    }
+}
+
+static
+uint32_t
+crc_table_driven(
+    const uint8_t *arr,
+    size_t length
+)
+{
+    uint32_t crc = ~0u;
+    for ( size_t i_ = 0;  i_ < length;  ++i_ ) {
+        crc = crc >> 8 ^ crc_table[ (crc ^ arr[ i_ ]) & 0xff ];
+    }
+
+    return ~crc;
+}
+
+
+
+// MAIN FUNCTION
+
+int
+main( void )
+{
+    uint32_t state    = 0x9e3779b9;
+    uint32_t checksum = 0;
+
+    for ( size_t i_ = 0;  i_ < CRC_LENGTH;  ++i_ ) {
+        byte_arr[ i_ ] = bench_rand( &state );
+    }
+    init_table();
+
+    // each pass changes one byte, so that no pass can be skipped
+    for ( uint32_t rep_ = 0;  rep_ < CRC_BITWISE_REP_COUNT;  ++rep_ ) {
+        byte_arr[ rep_ ] ^= checksum;
+        checksum ^= crc_bitwise( byte_arr, CRC_LENGTH );
+    }
+    for ( uint32_t rep_ = 0;  rep_ < CRC_TABLE_REP_COUNT;  ++rep_ ) {
+        byte_arr[ rep_ ] ^= checksum;
+        checksum ^= crc_table_driven( byte_arr, CRC_LENGTH );
+    }
+
+    return bench_check( "crc", checksum, CRC_EXPECTED );
+}
@@ -0,0 +1,81 @@
+// matrix-multiply benchmark
+
+
+
+// INCLUDES
+
+#include "../util/bench_utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+// DEFINES
+
+#define MATMUL_SIZE      32  // 32x32 words
+#define MATMUL_REP_COUNT 8
+#define MATMUL_EXPECTED  0xbcff0563u
+
+
+
+// STATIC DATA
+
+static uint32_t lhs_mat[ MATMUL_SIZE ][ MATMUL_SIZE ];
+static uint32_t rhs_mat[ MATMUL_SIZE ][ MATMUL_SIZE ];
+static uint32_t out_mat[ MATMUL_SIZE ][ MATMUL_SIZE ];
+
+
+
+// STATIC FUNCTION DEFINITIONS
+
+// Note that rv32i has no multiply instruction; the products are computed by
+// the libgcc routine, as compiled code on such a core would do.
+static
+void
+multiply( void )
+{
+    for ( size_t i_ = 0;  i_ < MATMUL_SIZE;  ++i_ ) {
+        for ( size_t j_ = 0;  j_ < MATMUL_SIZE;  ++j_ ) {
+            uint32_t sum = 0;
+            for ( size_t k_ = 0;  k_ < MATMUL_SIZE;  ++k_ ) {
+                sum += lhs_mat[ i_ ][ k_ ] * rhs_mat[ k_ ][ j_ ];
+            }
+            out_mat[ i_ ][ j_ ] = sum;
+        }
+    }
+}
+
+
+
+// MAIN FUNCTION
+
+int
+main( void )
+{
+    uint32_t state    = 0x2545f491;
+    uint32_t checksum = 0;
+
+    // small operands, so that the multiply loops vary in length
+    for ( size_t i_ = 0;  i_ < MATMUL_SIZE;  ++i_ ) {
+        for ( size_t j_ = 0;  j_ < MATMUL_SIZE;  ++j_ ) {
+            lhs_mat[ i_ ][ j_ ] = bench_rand( &state ) & 0xffff;
+            rhs_mat[ i_ ][ j_ ] = bench_rand( &state ) & 0xff;
+        }
+    }
+
+    for ( uint32_t rep_ = 0;  rep_ < MATMUL_REP_COUNT;  ++rep_ ) {
+        multiply();
+
+        // feed the result back, so that every repetition differs
+        for ( size_t i_ = 0;  i_ < MATMUL_SIZE;  ++i_ ) {
+            for ( size_t j_ = 0;  j_ < MATMUL_SIZE;  ++j_ ) {
+                checksum = (checksum << 5 | checksum >> 27)
+                         ^ out_mat[ i_ ][ j_ ];
+                lhs_mat[ i_ ][ j_ ] = out_mat[ i_ ][ j_ ] & 0xffff;
+            }
+        }
+    }
+
+    return bench_check( "matmul", checksum, MATMUL_EXPECTED );
+}
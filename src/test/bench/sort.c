@@ -0,0 +1,114 @@
+// sort benchmark
+
+
+
+// INCLUDES
+
+#include "../util/bench_utils.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+// DEFINES
+
+#define SORT_LENGTH    0x1000  // 4096 words
+#define SORT_REP_COUNT 40
+#define SORT_EXPECTED  0x90f19d3du
+
+
+
+// STATIC DATA
+
+static uint32_t word_arr[ SORT_LENGTH ];
+
+
+
+// STATIC FUNCTION DEFINITIONS
+
+static
+void
+insertion_sort(
+    uint32_t *arr,
+    size_t length
+)
+{
+    for ( size_t i_ = 1;  i_ < length;  ++i_ ) {
+        const uint32_t word = arr[ i_ ];
+        size_t j_ = i_;
+        for ( ;  j_ > 0 && arr[ j_ - 1 ] > word;  --j_ ) {
+            arr[ j_ ] = arr[ j_ - 1 ];
+        }
+        arr[ j_ ] = word;
+    }
+}
+
+// Quicksort with a median-of-three pivot; short ranges are left to
+// insertion sort.
+static
+void
+quick_sort(
+    uint32_t *arr,
+    size_t length
+)
+{
+    while ( length > 16 ) {
+        uint32_t a = arr[ 0 ];
+        uint32_t b = arr[ length / 2 ];
+        uint32_t c = arr[ length - 1 ];
+        const uint32_t pivot = a < b ? (b < c ? b : (a < c ? c : a))
+                                     : (a < c ? a : (b < c ? c : b));
+
+        size_t lo = 0;
+        size_t hi = length - 1;
+        for ( ;; ) {
+            while ( arr[ lo ] < pivot ) { ++lo; }
+            while ( arr[ hi ] > pivot ) { --hi; }
+            if ( lo >= hi ) { break; }
+
+            const uint32_t word = arr[ lo ];
+            arr[ lo++ ] = arr[ hi ];
+            arr[ hi-- ] = word;
+        }
+
+        // recurse into the smaller part; bounds the stack depth
+        const size_t split = hi + 1;
+        if ( split < length - split ) {
+            quick_sort( arr, split );
+            arr    += split;
+            length -= split;
+        }
+        else {
+            quick_sort( arr + split, length - split );
+            length = split;
+        }
+    }
+    insertion_sort( arr, length );
+}
+
+
+
+// MAIN FUNCTION
+
+int
+main( void )
+{
+    uint32_t state    = 0x12345678;
+    uint32_t checksum = 0;
+
+    for ( uint32_t rep_ = 0;  rep_ < SORT_REP_COUNT;  ++rep_ ) {
+        for ( size_t i_ = 0;  i_ < SORT_LENGTH;  ++i_ ) {
+            word_arr[ i_ ] = bench_rand( &state );
+        }
+
+        quick_sort( word_arr, SORT_LENGTH );
+
+        // order-sensitive; a misplaced word changes the sum
+        for ( size_t i_ = 0;  i_ < SORT_LENGTH;  ++i_ ) {
+            checksum = (checksum << 1 | checksum >> 31) ^ word_arr[ i_ ];
+        }
+    }
+
+    return bench_check( "sort", checksum, SORT_EXPECTED );
+}
@@ -0,0 +1,45 @@
+// bench utils
+
+
+
+// INCLUDES
+
+#include "bench_utils.h"
+#include "io_utils.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+
+
+// FUNCTION DEFINITIONS
+
+uint32_t
+bench_rand(
+    uint32_t *state
+)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+}
+
+int
+bench_check(
+    const char *name,
+    uint32_t checksum,
+    uint32_t expected
+)
+{
+    print( name );  print( ": checksum: " );  print_word( checksum );
+    if ( checksum != expected ) {
+        print( name );  println( ": checksum != expected: failure." );
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
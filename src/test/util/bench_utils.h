@@ -0,0 +1,18 @@
+#pragma once
+
+// bench utils
+
+
+
+// INCLUDES
+
+#include <stdint.h>
+
+
+
+// FUNCTION DECLARATIONS
+
+// xorshift32; deterministic and independent of the libc `rand`
+uint32_t bench_rand( uint32_t *state );
+// Prints the checksum; returns `EXIT_SUCCESS` if it is the expected one.
+int bench_check( const char *name, uint32_t checksum, uint32_t expected );
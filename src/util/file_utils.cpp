@@ -6,18 +6,22 @@
 
 #include "file_utils.hpp"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <system_error>
 #include <utility>
+#include <vector>
 
 #include <fcntl.h>      // open
 #include <sys/mman.h>   // mmap, munmap
 #include <sys/stat.h>   // open, fstat
 #include <sys/types.h>  // open, fstat
-#include <unistd.h>     // fstat, close
+#include <unistd.h>     // fstat, close, ftruncate, pread, pwrite, sysconf
 
 
 
@@ -25,15 +29,28 @@ namespace cpu_emu::util {
 
 // FUNCTION DEFINITIONS
 
+std::size_t
+page_ceil(
+    std::size_t size
+)
+{
+    const std::size_t page_size = sysconf( _SC_PAGESIZE );
+
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
 std::pair<
     std::uint8_t *,  // memory-map start address
-    std::size_t      // memory-map size
+    std::size_t      // memory-map size; whole pages
 >
 mmap_file(
-    const std::string &file_path
+    const std::string &file_path,
+    bool copy_on_write,
+    std::uint8_t *fixed_addr,
+    std::size_t fixed_size
 )
 {
-    auto fd = open( file_path.c_str(), O_RDWR );
+    auto fd = open( file_path.c_str(), copy_on_write ? O_RDONLY : O_RDWR );
     if ( fd == -1 ) {
         throw std::system_error( errno, std::system_category() );
     }
@@ -43,11 +60,30 @@ mmap_file(
         throw std::system_error( errno, std::system_category() );
     }
 
+    const std::size_t size = page_ceil( stat_.st_size );
+
+    // `MAP_FIXED` replaces whatever is mapped; never map past the reservation
+    if ( fixed_addr && size > fixed_size ) {
+        close( fd );
+        throw std::length_error( "File too large for the reservation." );
+    }
+
+    if (
+        !copy_on_write
+     && size != std::size_t( stat_.st_size )
+     && ftruncate( fd, size ) == -1
+    ) {
+        const auto errno_ = errno;
+        close( fd );
+        throw std::system_error( errno_, std::system_category() );
+    }
+
     auto start_addr = mmap(
-        NULL,  // addr
-        stat_.st_size,  // length
+        fixed_addr,  // addr
+        size,  // length
         PROT_READ | PROT_WRITE,
-        MAP_SHARED,
+        (copy_on_write ? MAP_PRIVATE : MAP_SHARED)
+            | (fixed_addr ? MAP_FIXED : 0),
         fd,
         0  // offset
     );
@@ -59,10 +95,7 @@ mmap_file(
         throw std::system_error( errno, std::system_category() );
     }
 
-    return {
-        reinterpret_cast< std::uint8_t * >( start_addr ),
-        stat_.st_size
-    };
+    return { reinterpret_cast< std::uint8_t * >( start_addr ), size };
 }
 
 void
@@ -76,4 +109,196 @@ munmap_file(
     }
 }
 
+std::pair<
+    int,         // file descriptor
+    std::size_t  // file size
+>
+open_file(
+    const std::string &file_path
+)
+{
+    auto fd = open( file_path.c_str(), O_RDONLY );
+    if ( fd == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    struct stat stat_;
+    if ( fstat( fd, &stat_ ) == -1 ) {
+        const auto errno_ = errno;
+        close( fd );
+        throw std::system_error( errno_, std::system_category() );
+    }
+
+    return { fd, stat_.st_size };
+}
+
+void
+close_file(
+    int fd
+)
+{
+    if ( close( fd ) == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+}
+
+std::uint8_t *
+mmap_fd(
+    int fd,
+    std::size_t size,
+    std::uint8_t *fixed_addr,
+    std::size_t offset
+)
+{
+    auto start_addr = mmap(
+        fixed_addr,  // addr
+        size,  // length
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | (fixed_addr ? MAP_FIXED : 0),
+        fd,
+        offset
+    );
+    if ( start_addr == MAP_FAILED ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    return reinterpret_cast< std::uint8_t * >( start_addr );
+}
+
+std::uint8_t *
+mmap_anonymous(
+    std::size_t size,
+    std::uint8_t *fixed_addr
+)
+{
+    auto start_addr = mmap(
+        fixed_addr,  // addr
+        size,  // length
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | (fixed_addr ? MAP_FIXED : 0),
+        -1,  // fd
+        0  // offset
+    );
+    if ( start_addr == MAP_FAILED ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    return reinterpret_cast< std::uint8_t * >( start_addr );
+}
+
+std::uint8_t *
+reserve_addr_space(
+    std::size_t size
+)
+{
+    auto start_addr = mmap(
+        NULL,  // addr
+        size,  // length
+        PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+        -1,  // fd
+        0  // offset
+    );
+    if ( start_addr == MAP_FAILED ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    return reinterpret_cast< std::uint8_t * >( start_addr );
+}
+
+void
+read_fd(
+    int fd,
+    std::uint8_t *data,
+    std::size_t size,
+    std::size_t offset
+)
+{
+    for ( std::size_t done_ = 0;  done_ < size; ) {
+        const auto count =
+                pread( fd, data + done_, size - done_, offset + done_ );
+        if ( count == -1 ) {
+            throw std::system_error( errno, std::system_category() );
+        }
+        if ( count == 0 ) {
+            throw std::runtime_error( "Unexpected end of file." );
+        }
+        done_ += count;
+    }
+}
+
+void
+dump_file(
+    const std::string &file_path,
+    const std::uint8_t *data,
+    std::size_t size
+)
+{
+    auto fd = open( file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if ( fd == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    for ( std::size_t done_ = 0;  done_ < size; ) {
+        const auto count = write( fd, data + done_, size - done_ );
+        if ( count == -1 ) {
+            const auto errno_ = errno;
+            close( fd );
+            throw std::system_error( errno_, std::system_category() );
+        }
+        done_ += count;
+    }
+
+    if ( close( fd ) == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+}
+
+void
+write_back_file(
+    const std::string &file_path,
+    const std::uint8_t *data,
+    std::size_t size,
+    std::size_t page_size,
+    const std::vector< std::size_t > &page_vec
+)
+{
+    auto fd = open( file_path.c_str(), O_WRONLY );
+    if ( fd == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+
+    // consecutive pages are written at once
+    for ( std::size_t i_ = 0;  i_ < page_vec.size(); ) {
+        std::size_t end_ = i_ + 1;
+        while (
+            end_ < page_vec.size()
+         && page_vec[ end_ ] == page_vec[ end_ - 1 ] + 1
+        ) {
+            ++end_;
+        }
+
+        const std::size_t offset = page_vec[ i_ ] * page_size;
+        const std::size_t length =
+                std::min( (page_vec[ end_ - 1 ] + 1) * page_size, size )
+              - offset;
+        for ( std::size_t done_ = 0;  done_ < length; ) {
+            const auto count = pwrite(
+                    fd, data + offset + done_, length - done_,
+                    offset + done_ );
+            if ( count == -1 ) {
+                const auto errno_ = errno;
+                close( fd );
+                throw std::system_error( errno_, std::system_category() );
+            }
+            done_ += count;
+        }
+        i_ = end_;
+    }
+
+    if ( close( fd ) == -1 ) {
+        throw std::system_error( errno, std::system_category() );
+    }
+}
+
 }  // END cpu_emu::util
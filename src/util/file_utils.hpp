@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <string>
 #include <utility>
+#include <vector>
 
 
 
@@ -17,12 +18,23 @@ namespace cpu_emu::util {
 
 // FUNCTION DECLARATIONS
 
+// Rounds `size` up to whole host pages, the granularity of mappings.
+std::size_t
+page_ceil(
+    std::size_t size
+);
+
+// Maps the whole pages of the file; a shared mapping extends the file to
+// them first, so that the rest of its last page is stored too.
 std::pair<
     std::uint8_t *,  // memory-map start address
-    std::size_t      // memory-map size
+    std::size_t      // memory-map size; whole pages
 >
 mmap_file(
-    const std::string &file_path
+    const std::string &file_path,
+    bool copy_on_write = false,  // private mapping; the file is not modified
+    std::uint8_t *fixed_addr = nullptr,  // map over e.g. a reservation
+    std::size_t fixed_size = 0           // at `fixed_addr`; the file must fit
 );
 
 void
@@ -31,4 +43,68 @@ munmap_file(
     std::size_t size           // memory-map size
 );
 
+// Opens the file read-only; returns its descriptor and size.
+std::pair<
+    int,         // file descriptor
+    std::size_t  // file size
+>
+open_file(
+    const std::string &file_path
+);
+
+void
+close_file(
+    int fd
+);
+
+// Maps an open file copy-on-write; see `mmap_file`.
+std::uint8_t *
+mmap_fd(
+    int fd,
+    std::size_t size,
+    std::uint8_t *fixed_addr = nullptr,  // map over e.g. a reservation
+    std::size_t offset = 0               // must be page-aligned
+);
+
+// Maps zero-filled, writable memory.
+std::uint8_t *
+mmap_anonymous(
+    std::size_t size,
+    std::uint8_t *fixed_addr = nullptr  // map over e.g. a reservation
+);
+
+// Reserves inaccessible address space; release it with `munmap_file`.
+std::uint8_t *
+reserve_addr_space(
+    std::size_t size
+);
+
+// Reads exactly `size` bytes at `offset` of the open file into `data`.
+void
+read_fd(
+    int fd,
+    std::uint8_t *data,
+    std::size_t size,
+    std::size_t offset
+);
+
+// Writes `size` bytes from `data` to the file; creates or truncates it.
+void
+dump_file(
+    const std::string &file_path,
+    const std::uint8_t *data,
+    std::size_t size
+);
+
+// Writes the listed pages of `data` over the file, without reading it; the
+// last page of `data` may be short.
+void
+write_back_file(
+    const std::string &file_path,
+    const std::uint8_t *data,
+    std::size_t size,
+    std::size_t page_size,
+    const std::vector< std::size_t > &page_vec  // ascending
+);
+
 }  // END cpu_emu::util